@@ -1,6 +1,21 @@
+#include <stdint.h>
 #include <stdio.h>
-#include <ctype.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#include "keywords.h"
+#include "token_file.h"
+
+// Define LEXER_NO_SIMD to build with the scalar scanner only
+#if defined(LEXER_NO_SIMD)
+#elif defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define LEXER_HAVE_X86_SIMD 1
+#elif defined(__aarch64__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define LEXER_HAVE_NEON 1
+#endif
 
 // Define token types
 typedef enum {
@@ -9,25 +24,245 @@ typedef enum {
     TOKEN_OPERATOR,
     TOKEN_KEYWORD,
     TOKEN_EOF,
+    TOKEN_SEPARATOR,
+    TOKEN_STRING,
     // Add more token types as needed
 } TokenType;
 
-// Define a token structure
+// Define a zero-copy token: an (offset, length) view into Lexer.input
 typedef struct {
     TokenType type;
-    char value[256];
+    size_t offset;
+    size_t length;
+    size_t line;
+} TokenView;
+
+// Define a struct-of-arrays token batch: caller-owned arrays of `capacity` entries each,
+// filled by lexer_next_batch. Offsets and lengths index Lexer.input (inputs below 4 GiB).
+typedef struct {
+    TokenType *types;
+    uint32_t *offsets;
+    uint32_t *lengths;
+    uint32_t *lines;
+    size_t capacity;
+} TokenBatch;
+
+// Define a text edit: bytes [start, old_end) of the old input became [start, new_end) of the new one
+typedef struct {
+    size_t start;
+    size_t old_end;
+    size_t new_end;
+} LexerEdit;
+
+#ifdef LEXER_COPY_TOKENS
+// Define a copying token structure (compatibility mode, opt-in with -DLEXER_COPY_TOKENS)
+#define TOKEN_VALUE_SIZE 256
+
+typedef struct {
+    TokenType type;
+    char value[TOKEN_VALUE_SIZE];
 } Token;
+#endif
+
+// Character classes, one bit each, looked up through char_class[]
+enum {
+    CHAR_SPACE = 1 << 0,       // ' ', '\t', '\n', '\r' (not '\v' or '\f', as in ParsesIndex.rs)
+    CHAR_IDENT_START = 1 << 1, // 'A'-'Z', 'a'-'z', '_'
+    CHAR_DIGIT = 1 << 2,       // '0'-'9'
+    CHAR_OPERATOR = 1 << 3,    // '+', '-', '*', '/', '=', '!', '<', '>'
+    CHAR_SEPARATOR = 1 << 4,   // '(', ')', '{', '}', ',', ';', ':'
+};
+#define CHAR_IDENT (CHAR_IDENT_START | CHAR_DIGIT)
+
+#define S CHAR_SPACE
+#define I CHAR_IDENT_START
+#define D CHAR_DIGIT
+#define O CHAR_OPERATOR
+#define P CHAR_SEPARATOR
+// Precomputed 256-entry class table (locale-independent, replaces isspace/isalpha/isalnum/isdigit)
+static const unsigned char char_class[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, S, S, 0, 0, S, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    S, O, 0, 0, 0, 0, 0, 0, P, P, O, O, P, O, 0, O,
+    D, D, D, D, D, D, D, D, D, D, P, P, O, O, O, 0,
+    0, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, 0, 0, 0, 0, I,
+    0, I, I, I, I, I, I, I, I, I, I, I, I, I, I, I,
+    I, I, I, I, I, I, I, I, I, I, I, P, 0, P, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+#undef S
+#undef I
+#undef D
+#undef O
+#undef P
+
+// Scanner signature: return the first position in [pos, end) whose byte is not in `cls`
+typedef size_t (*LexerScanFn)(const unsigned char *input, size_t pos, size_t end, unsigned char cls);
+
+// Function to scan a run of one character class, one byte at a time
+static size_t lexer_scan_scalar(const unsigned char *input, size_t pos, size_t end, unsigned char cls) {
+    while (pos < end && (char_class[input[pos]] & cls)) {
+        pos++;
+    }
+    return pos;
+}
+
+#ifdef LEXER_HAVE_X86_SIMD
+// Bytes of v with (v - lo) <= span as 0xFF, unsigned compare via min
+__attribute__((target("sse2")))
+static inline __m128i sse2_in_range(__m128i v, char lo, char span) {
+    __m128i d = _mm_sub_epi8(v, _mm_set1_epi8(lo));
+    return _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(span)), d);
+}
+
+__attribute__((target("sse2")))
+static inline __m128i sse2_class_mask(__m128i v, unsigned char cls) {
+    if (cls == CHAR_SPACE) {
+        __m128i tab_newline = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        __m128i return_space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8(' ')));
+        return _mm_or_si128(tab_newline, return_space);
+    }
+    __m128i digit = sse2_in_range(v, '0', 9);
+    if (cls == CHAR_DIGIT) {
+        return digit;
+    }
+    __m128i alpha = sse2_in_range(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 25);
+    return _mm_or_si128(_mm_or_si128(digit, alpha), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+}
+
+// Function to scan a character class run 16 bytes at a time (SSE2)
+__attribute__((target("sse2")))
+static size_t lexer_scan_sse2(const unsigned char *input, size_t pos, size_t end, unsigned char cls) {
+    while (pos + 16 <= end) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (input + pos));
+        unsigned miss = ~(unsigned) _mm_movemask_epi8(sse2_class_mask(v, cls)) & 0xFFFFu;
+        if (miss) {
+            return pos + (size_t) __builtin_ctz(miss);
+        }
+        pos += 16;
+    }
+    return lexer_scan_scalar(input, pos, end, cls);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_in_range(__m256i v, char lo, char span) {
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8(lo));
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(span)), d);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i avx2_class_mask(__m256i v, unsigned char cls) {
+    if (cls == CHAR_SPACE) {
+        __m256i tab_newline = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        __m256i return_space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')));
+        return _mm256_or_si256(tab_newline, return_space);
+    }
+    __m256i digit = avx2_in_range(v, '0', 9);
+    if (cls == CHAR_DIGIT) {
+        return digit;
+    }
+    __m256i alpha = avx2_in_range(_mm256_or_si256(v, _mm256_set1_epi8(0x20)), 'a', 25);
+    return _mm256_or_si256(_mm256_or_si256(digit, alpha), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+}
+
+// Function to scan a character class run 32 bytes at a time (AVX2)
+__attribute__((target("avx2")))
+static size_t lexer_scan_avx2(const unsigned char *input, size_t pos, size_t end, unsigned char cls) {
+    while (pos + 32 <= end) {
+        __m256i v = _mm256_loadu_si256((const __m256i *) (input + pos));
+        unsigned miss = ~(unsigned) _mm256_movemask_epi8(avx2_class_mask(v, cls));
+        if (miss) {
+            return pos + (size_t) __builtin_ctz(miss);
+        }
+        pos += 32;
+    }
+    return lexer_scan_sse2(input, pos, end, cls);
+}
+#endif
+
+#ifdef LEXER_HAVE_NEON
+static inline uint8x16_t neon_in_range(uint8x16_t v, unsigned char lo, unsigned char span) {
+    return vcleq_u8(vsubq_u8(v, vdupq_n_u8(lo)), vdupq_n_u8(span));
+}
+
+static inline uint8x16_t neon_class_mask(uint8x16_t v, unsigned char cls) {
+    if (cls == CHAR_SPACE) {
+        uint8x16_t tab_newline = vorrq_u8(vceqq_u8(v, vdupq_n_u8('\t')), vceqq_u8(v, vdupq_n_u8('\n')));
+        uint8x16_t return_space = vorrq_u8(vceqq_u8(v, vdupq_n_u8('\r')), vceqq_u8(v, vdupq_n_u8(' ')));
+        return vorrq_u8(tab_newline, return_space);
+    }
+    uint8x16_t digit = neon_in_range(v, '0', 9);
+    if (cls == CHAR_DIGIT) {
+        return digit;
+    }
+    uint8x16_t alpha = neon_in_range(vorrq_u8(v, vdupq_n_u8(0x20)), 'a', 25);
+    return vorrq_u8(vorrq_u8(digit, alpha), vceqq_u8(v, vdupq_n_u8('_')));
+}
+
+// Function to scan a character class run 16 bytes at a time (NEON)
+static size_t lexer_scan_neon(const unsigned char *input, size_t pos, size_t end, unsigned char cls) {
+    while (pos + 16 <= end) {
+        uint8x16_t mask = neon_class_mask(vld1q_u8(input + pos), cls);
+        // Narrow to 4 bits per byte so the mask fits in one 64-bit lane
+        uint64_t bits = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(mask), 4)), 0);
+        if (bits != ~(uint64_t) 0) {
+            return pos + (size_t) (__builtin_ctzll(~bits) >> 2);
+        }
+        pos += 16;
+    }
+    return lexer_scan_scalar(input, pos, end, cls);
+}
+#endif
+
+// Function to pick the widest scanner the running CPU supports
+static LexerScanFn lexer_select_scan(void) {
+#if defined(LEXER_HAVE_X86_SIMD) && defined(__GNUC__)
+    if (__builtin_cpu_supports("avx2")) {
+        return lexer_scan_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return lexer_scan_sse2;
+    }
+    return lexer_scan_scalar;
+#elif defined(LEXER_HAVE_NEON)
+    // NEON is mandatory on arm64, so no runtime probe is needed there
+    return lexer_scan_neon;
+#else
+    return lexer_scan_scalar;
+#endif
+}
 
 // Define a lexer structure
 typedef struct {
     const char *input;
     size_t pos;
+    size_t length;
+    size_t line;
+    LexerScanFn scan;
+    const KeywordTable *keywords;
 } Lexer;
 
 // Function to initialize the lexer
 void lexer_init(Lexer *lexer, const char *input) {
     lexer->input = input;
     lexer->pos = 0;
+    lexer->length = strlen(input);
+    lexer->line = 1;
+    lexer->scan = lexer_select_scan();
+    lexer->keywords = &keyword_builtin;
+}
+
+// Function to switch the lexer to a dialect keyword table (see keyword_table_load)
+void lexer_set_keywords(Lexer *lexer, const KeywordTable *keywords) {
+    lexer->keywords = keywords;
 }
 
 // Function to get the next character
@@ -40,71 +275,587 @@ char lexer_peek_char(Lexer *lexer) {
     return lexer->input[lexer->pos];
 }
 
-// Function to recognize identifiers and keywords
-Token lexer_next_token(Lexer *lexer) {
-    Token token;
-    char c = lexer_next_char(lexer);
+// Function to get a token's text without copying (not NUL-terminated, see view->length)
+const char *lexer_token_text(const Lexer *lexer, const TokenView *view) {
+    return lexer->input + view->offset;
+}
+
+// Function to count the newlines in [from, to)
+static size_t lexer_count_lines(const char *input, size_t from, size_t to) {
+    size_t lines = 0;
+    const char *p = input + from, *end = input + to;
+    while ((p = memchr(p, '\n', (size_t) (end - p))) != NULL) {
+        lines++;
+        p++;
+    }
+    return lines;
+}
+
+// Function to skip whitespace and // comments, counting the newlines in the whitespace
+// (a comment stops before its newline)
+static void lexer_skip_trivia(Lexer *lexer) {
+    const unsigned char *input = (const unsigned char *) lexer->input;
+    for (;;) {
+        size_t start = lexer->pos;
+        lexer->pos = lexer->scan(input, start, lexer->length, CHAR_SPACE);
+        lexer->line += lexer_count_lines(lexer->input, start, lexer->pos);
+        if (lexer->pos + 1 >= lexer->length || input[lexer->pos] != '/' || input[lexer->pos + 1] != '/') {
+            return;
+        }
+        const char *newline = memchr(lexer->input + lexer->pos, '\n', lexer->length - lexer->pos);
+        lexer->pos = newline != NULL ? (size_t) (newline - lexer->input) : lexer->length;
+    }
+}
+
+// Function to recognize the next token: the token set of the ParsesIndex lexer
+TokenView lexer_next_view(Lexer *lexer) {
+    TokenView view;
+    const unsigned char *input = (const unsigned char *) lexer->input;
 
-    // Skip whitespace
-    while (isspace(c)) {
-        c = lexer_next_char(lexer);
+    lexer_skip_trivia(lexer);
+    view.offset = lexer->pos;
+    view.line = lexer->line;
+
+    if (lexer->pos >= lexer->length) {
+        // End of input
+        view.type = TOKEN_EOF;
+        view.length = 0;
+        return view;
     }
 
+    unsigned char cls = char_class[input[lexer->pos]];
+
     // Recognize identifiers and keywords
-    if (isalpha(c) || c == '_') {
-        size_t start = lexer->pos - 1;
-        while (isalnum(lexer_peek_char(lexer)) || lexer_peek_char(lexer) == '_') {
-            lexer_next_char(lexer);
-        }
-        size_t length = lexer->pos - start;
-        strncpy(token.value, lexer->input + start, length);
-        token.value[length] = '\0';
-        token.type = TOKEN_IDENTIFIER;
+    if (cls & CHAR_IDENT_START) {
+        lexer->pos = lexer->scan(input, lexer->pos + 1, lexer->length, CHAR_IDENT);
+        view.length = lexer->pos - view.offset;
+        view.type = TOKEN_IDENTIFIER;
         // Check if the identifier is a keyword (e.g., "function", "var")
-        if (strcmp(token.value, "function") == 0 || strcmp(token.value, "var") == 0) {
-            token.type = TOKEN_KEYWORD;
+        if (keyword_lookup(lexer->keywords, lexer->input + view.offset, view.length) >= 0) {
+            view.type = TOKEN_KEYWORD;
+        }
+        return view;
+    }
+
+    // Recognize numbers, with an optional fraction ("1.5" but not "1." or "1.x")
+    if (cls & CHAR_DIGIT) {
+        lexer->pos = lexer->scan(input, lexer->pos + 1, lexer->length, CHAR_DIGIT);
+        if (lexer->pos + 1 < lexer->length && input[lexer->pos] == '.' && (char_class[input[lexer->pos + 1]] & CHAR_DIGIT)) {
+            lexer->pos = lexer->scan(input, lexer->pos + 2, lexer->length, CHAR_DIGIT);
         }
-        return token;
+        view.length = lexer->pos - view.offset;
+        view.type = TOKEN_NUMBER;
+        return view;
     }
 
-    // Recognize numbers
-    if (isdigit(c)) {
-        size_t start = lexer->pos - 1;
-        while (isdigit(lexer_peek_char(lexer))) {
-            lexer_next_char(lexer);
+    // Recognize operators: "==", "!=", "<=" and ">=" are one token, "->" is a separator
+    if (cls & CHAR_OPERATOR) {
+        unsigned char c = input[lexer->pos++];
+        unsigned char next = lexer->pos < lexer->length ? input[lexer->pos] : '\0';
+        view.type = TOKEN_OPERATOR;
+        if (c == '-' && next == '>') {
+            lexer->pos++;
+            view.type = TOKEN_SEPARATOR;
+        } else if ((c == '=' || c == '!' || c == '<' || c == '>') && next == '=') {
+            lexer->pos++;
         }
-        size_t length = lexer->pos - start;
-        strncpy(token.value, lexer->input + start, length);
-        token.value[length] = '\0';
-        token.type = TOKEN_NUMBER;
-        return token;
+        view.length = lexer->pos - view.offset;
+        return view;
     }
 
-    // Recognize operators
-    if (strchr("+-*/=", c)) {
-        token.value[0] = c;
-        token.value[1] = '\0';
-        token.type = TOKEN_OPERATOR;
-        return token;
+    // Recognize separators
+    if (cls & CHAR_SEPARATOR) {
+        lexer->pos++;
+        view.length = 1;
+        view.type = TOKEN_SEPARATOR;
+        return view;
     }
 
-    // End of input
-    token.type = TOKEN_EOF;
-    token.value[0] = '\0';
+    // Recognize string literals (quotes included, no escapes); they may span lines
+    if (input[lexer->pos] == '"') {
+        const char *quote = memchr(lexer->input + view.offset + 1, '"', lexer->length - view.offset - 1);
+        if (quote == NULL) {
+            // Unterminated string: report EOF at the opening quote and consume the rest
+            lexer->pos = lexer->length;
+            view.type = TOKEN_EOF;
+            view.length = 0;
+            return view;
+        }
+        lexer->pos = (size_t) (quote - lexer->input) + 1;
+        lexer->line += lexer_count_lines(lexer->input, view.offset, lexer->pos);
+        view.length = lexer->pos - view.offset;
+        view.type = TOKEN_STRING;
+        return view;
+    }
+
+    // Unrecognized character: report EOF and consume it, as before
+    lexer->pos++;
+    view.type = TOKEN_EOF;
+    view.length = 0;
+    return view;
+}
+
+// Function to fill a batch with up to batch->capacity tokens; returns how many were written.
+// A batch ends early only after writing TOKEN_EOF, so a short batch means the stream is done.
+size_t lexer_next_batch(Lexer *lexer, TokenBatch *batch) {
+    size_t count = 0;
+    while (count < batch->capacity) {
+        TokenView view = lexer_next_view(lexer);
+        batch->types[count] = view.type;
+        batch->offsets[count] = (uint32_t) view.offset;
+        batch->lengths[count] = (uint32_t) view.length;
+        batch->lines[count] = (uint32_t) view.line;
+        count++;
+        if (view.type == TOKEN_EOF) {
+            break;
+        }
+    }
+    return count;
+}
+
+// Function to resume lexing at a token boundary: a token's offset (or 0) and its line.
+// The lexer keeps no state between tokens, so this is a complete restart point.
+void lexer_seek(Lexer *lexer, size_t offset, size_t line) {
+    lexer->pos = offset;
+    lexer->line = line;
+}
+
+// Function to find the first of tokens[lo, hi) whose offset is at least `offset`
+static size_t lexer_lower_bound(const TokenView *tokens, size_t lo, size_t hi, size_t offset) {
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (tokens[mid].offset < offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Function to patch a token array after an edit. tokens[0, count) are the views of the old input,
+// through its final TOKEN_EOF; the lexer must already be initialized on the new input. Lexing
+// restarts two tokens before the first token at or after the edit (a number looks two bytes past
+// its end, through a "." token, to find a fraction) and stops as soon as a new token starts
+// where a shifted old token past the edit started: the bytes from there on are unchanged, so the
+// old tail is moved and its offsets and lines adjusted. New views are staged at the top of
+// tokens[count, capacity). Returns the new count, or (size_t) -1 without modifying tokens[0, count)
+// if capacity is too small.
+size_t lexer_relex(Lexer *lexer, TokenView *tokens, size_t count, size_t capacity, LexerEdit edit) {
+    size_t first = lexer_lower_bound(tokens, 0, count, edit.start);
+    size_t tail = lexer_lower_bound(tokens, first, count, edit.old_end);
+    size_t staged = 0, sync = count;
+    TokenView view;
+
+    first = first > 2 ? first - 2 : 0;
+    if (first > 0) {
+        lexer_seek(lexer, tokens[first].offset, tokens[first].line);
+    } else {
+        lexer_seek(lexer, 0, 1);
+    }
+
+    for (;;) {
+        view = lexer_next_view(lexer);
+        if (view.offset >= edit.new_end) {
+            size_t old_offset = view.offset - edit.new_end + edit.old_end;
+            size_t match = lexer_lower_bound(tokens, tail, count, old_offset);
+            if (match < count && tokens[match].offset == old_offset) {
+                sync = match;
+                break;
+            }
+        }
+        if (capacity - count <= staged) {
+            return (size_t) -1;
+        }
+        tokens[capacity - 1 - staged++] = view;
+        if (view.type == TOKEN_EOF && view.offset >= lexer->length) {
+            break;
+        }
+    }
+
+    // Final layout: prefix, the staged views, then the old tail from `sync`
+    size_t tail_count = count - sync;
+    size_t new_count = first + staged + tail_count;
+    if (new_count > capacity - staged) {
+        return (size_t) -1;
+    }
+    size_t line_shift = view.line - (sync < count ? tokens[sync].line : view.line);
+    memmove(tokens + first + staged, tokens + sync, tail_count * sizeof(TokenView));
+    for (size_t i = first + staged; i < new_count; i++) {
+        tokens[i].offset = tokens[i].offset + edit.new_end - edit.old_end;
+        tokens[i].line += line_shift;
+    }
+    for (size_t i = 0; i < staged; i++) {
+        tokens[first + i] = tokens[capacity - 1 - i];
+    }
+    return new_count;
+}
+
+#ifdef LEXER_COPY_TOKENS
+// Function to get the next token as a copy (text longer than TOKEN_VALUE_SIZE - 1 is truncated)
+Token lexer_next_token(Lexer *lexer) {
+    Token token;
+    TokenView view = lexer_next_view(lexer);
+    size_t length = view.length < TOKEN_VALUE_SIZE ? view.length : TOKEN_VALUE_SIZE - 1;
+
+    memcpy(token.value, lexer_token_text(lexer, &view), length);
+    token.value[length] = '\0';
+    token.type = view.type;
     return token;
 }
+#endif
+
+// Function to read the current time in seconds (C11 timespec_get, also available on MSVC)
+static double lexer_bench_now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double) ts.tv_sec + (double) ts.tv_nsec / 1e9;
+}
+
+// Function to read a whole file into a NUL-terminated buffer (free() it); NULL on error
+static char *lexer_read_file(const char *path, long *size) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return NULL;
+    }
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *input = *size >= 0 ? malloc((size_t) *size + 1) : NULL;
+    if (input == NULL || fread(input, 1, (size_t) *size, file) != (size_t) *size) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        fclose(file);
+        free(input);
+        return NULL;
+    }
+    fclose(file);
+    input[*size] = '\0';
+    return input;
+}
 
-// Main function for testing
-int main() {
+// Function to lex `input` into a token file (see token_file.h) for ParsesIndex to parse.
+// Columns are derived from the newlines since the previous token's start (a string may
+// contain some). Fails with a message on a character the lexer does not recognize or an
+// unterminated string, which the format has no token type for, and on inputs of 4 GiB
+// or more.
+static int lexer_write_token_file(const char *input, size_t length, const KeywordTable *keywords,
+                                  StringBuilder *out) {
+    static const uint8_t file_types[] = {
+        [TOKEN_IDENTIFIER] = TOKEN_FILE_IDENTIFIER,
+        [TOKEN_NUMBER] = TOKEN_FILE_LITERAL,
+        [TOKEN_OPERATOR] = TOKEN_FILE_OPERATOR,
+        [TOKEN_KEYWORD] = TOKEN_FILE_KEYWORD,
+        [TOKEN_EOF] = TOKEN_FILE_EOF,
+        [TOKEN_SEPARATOR] = TOKEN_FILE_SEPARATOR,
+        [TOKEN_STRING] = TOKEN_FILE_LITERAL,
+    };
+    enum { BATCH = 4096 };
+    TokenType batch_types[BATCH];
+    uint32_t batch_offsets[BATCH], batch_lengths[BATCH], batch_lines[BATCH];
+    TokenBatch batch = {batch_types, batch_offsets, batch_lengths, batch_lines, BATCH};
+    uint8_t *types = NULL;
+    uint32_t *offsets = NULL, *lengths = NULL, *lines = NULL, *columns = NULL;
+    size_t count = 0, capacity = 0, line_start = 0, scanned = 0;
+    int status = -1;
+    Lexer lexer;
+
+    if (length > UINT32_MAX) {
+        fprintf(stderr, "Input too large for a token file\n");
+        return -1;
+    }
+    lexer_init(&lexer, input);
+    lexer_set_keywords(&lexer, keywords);
+    for (;;) {
+        size_t n = lexer_next_batch(&lexer, &batch);
+        if (count + n > capacity) {
+            capacity = capacity ? capacity * 2 : BATCH;
+            uint8_t *t = realloc(types, capacity);
+            types = t ? t : types;
+            uint32_t *o = realloc(offsets, capacity * sizeof *o);
+            offsets = o ? o : offsets;
+            uint32_t *l = realloc(lengths, capacity * sizeof *l);
+            lengths = l ? l : lengths;
+            uint32_t *ln = realloc(lines, capacity * sizeof *ln);
+            lines = ln ? ln : lines;
+            uint32_t *c = realloc(columns, capacity * sizeof *c);
+            columns = c ? c : columns;
+            if (!t || !o || !l || !ln || !c) {
+                fprintf(stderr, "Out of memory\n");
+                goto done;
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            uint32_t offset = batch.offsets[i];
+            if (batch.types[i] == TOKEN_EOF && offset < length) {
+                if (input[offset] == '"') {
+                    fprintf(stderr, "Unterminated string at line %u\n", batch.lines[i]);
+                } else {
+                    fprintf(stderr, "Unexpected character '%c' at line %u\n", input[offset], batch.lines[i]);
+                }
+                goto done;
+            }
+            // The last newline before this token starts its line
+            const char *gap = input + scanned, *newline;
+            while ((newline = memchr(gap, '\n', (size_t) (input + offset - gap))) != NULL) {
+                gap = newline + 1;
+                line_start = (size_t) (gap - input);
+            }
+            scanned = offset;
+            types[count] = file_types[batch.types[i]];
+            offsets[count] = offset;
+            lengths[count] = batch.lengths[i];
+            lines[count] = batch.lines[i];
+            columns[count] = (uint32_t) (offset - line_start + 1);
+            count++;
+        }
+        if (n < BATCH || batch.types[n - 1] == TOKEN_EOF) {
+            break;
+        }
+    }
+    status = token_file_write_tokens(out, input, length, types, offsets, lengths, lines, columns, (uint32_t) count);
+    if (status != 0) {
+        fprintf(stderr, "Out of memory\n");
+    }
+done:
+    free(types);
+    free(offsets);
+    free(lengths);
+    free(lines);
+    free(columns);
+    return status;
+}
+
+// Function to write the token file of the source at `path` to `output_path`
+static int lexer_emit_tokens(const char *path, const char *output_path, const KeywordTable *keywords) {
+    long size;
+    char *input = lexer_read_file(path, &size);
+    if (input == NULL) {
+        return 1;
+    }
+    StringBuilder out;
+    string_builder_init(&out);
+    int status = lexer_write_token_file(input, (size_t) size, keywords, &out);
+    free(input);
+    if (status == 0) {
+        FILE *file = fopen(output_path, "wb");
+        if (file == NULL || fwrite(out.data, 1, out.length, file) != out.length) {
+            fprintf(stderr, "Cannot write %s\n", output_path);
+            status = -1;
+        }
+        if (file != NULL && fclose(file) != 0) {
+            status = -1;
+        }
+    }
+    string_builder_free(&out);
+    return status == 0 ? 0 : 1;
+}
+
+// Function to benchmark lexer_next_view over a whole file (e.g. from ParsesIndex --gen-corpus).
+// Prints one JSON record in the same layout as ParsesIndex --bench. Characters the lexer does not
+// recognize come back as TOKEN_EOF views and are counted as tokens.
+static int lexer_bench(const char *path, int iterations, const KeywordTable *keywords) {
+    long size;
+    char *input = lexer_read_file(path, &size);
+    if (input == NULL) {
+        return 1;
+    }
+
+    double best = 0.0, total = 0.0;
+    size_t tokens = 0;
+    if (iterations < 1) {
+        iterations = 1;
+    }
+    for (int i = 0; i < iterations; i++) {
+        Lexer lexer;
+        TokenView view;
+        size_t count = 0;
+        double start = lexer_bench_now();
+        lexer_init(&lexer, input);
+        lexer_set_keywords(&lexer, keywords);
+        do {
+            view = lexer_next_view(&lexer);
+            count++;
+        } while (view.type != TOKEN_EOF || lexer.pos < lexer.length);
+        double elapsed = lexer_bench_now() - start;
+        if (i == 0 || elapsed < best) {
+            best = elapsed;
+        }
+        total += elapsed;
+        tokens = count;
+    }
+
+    double seconds = best > 1e-9 ? best : 1e-9;
+    printf("{\"stage\":\"c-lexer\",\"bytes\":%ld,\"tokens\":%zu,\"nodes\":0,\"iterations\":%d,"
+           "\"best_s\":%.6f,\"mean_s\":%.6f,\"mb_per_s\":%.2f,\"tokens_per_s\":%.0f,\"nodes_per_s\":0}\n",
+           size, tokens, iterations, best, total / iterations, (double) size / 1e6 / seconds,
+           (double) tokens / seconds);
+    free(input);
+    return 0;
+}
+
+// Function to lex a whole input into views through the final TOKEN_EOF (the one at the end of the
+// input, as in lexer_relex), leaving `spare` free entries after them; returns a malloc'd array (NULL on allocation failure)
+static TokenView *lexer_lex_all(const char *input, size_t spare, size_t *count) {
+    Lexer lexer;
+    size_t capacity = 64 + spare;
+    TokenView *tokens = malloc(capacity * sizeof(TokenView));
+
+    lexer_init(&lexer, input);
+    *count = 0;
+    while (tokens != NULL) {
+        if (*count + spare == capacity) {
+            TokenView *grown = realloc(tokens, (capacity *= 2) * sizeof(TokenView));
+            if (grown == NULL) {
+                free(tokens);
+                return NULL;
+            }
+            tokens = grown;
+        }
+        TokenView view = tokens[(*count)++] = lexer_next_view(&lexer);
+        if (view.type == TOKEN_EOF && view.offset >= lexer.length) {
+            break;
+        }
+    }
+    return tokens;
+}
+
+// Function to check one edit: relexing the old views must give exactly a fresh lex of new_input
+static int lexer_relex_matches(const char *old_input, const char *new_input, LexerEdit edit) {
+    size_t count, fresh_count, spare = 2 * (strlen(new_input) + 2);
+    TokenView *tokens = lexer_lex_all(old_input, spare, &count);
+    TokenView *fresh = lexer_lex_all(new_input, 0, &fresh_count);
+    Lexer lexer;
+    int ok = tokens != NULL && fresh != NULL;
+
+    if (ok) {
+        lexer_init(&lexer, new_input);
+        count = lexer_relex(&lexer, tokens, count, count + spare, edit);
+        ok = count == fresh_count;
+        for (size_t i = 0; ok && i < count; i++) {
+            ok = tokens[i].type == fresh[i].type && tokens[i].offset == fresh[i].offset &&
+                 tokens[i].length == fresh[i].length && tokens[i].line == fresh[i].line;
+        }
+    }
+    free(tokens);
+    free(fresh);
+    return ok;
+}
+
+// Function to fuzz lexer_relex: random edits of sources built from fragments that exercise the
+// lookahead (fractions, two-byte operators, comments, strings, errors), each checked against a
+// fresh lex. Returns 0 if all match.
+static int lexer_relex_fuzz(long cases) {
+    static const char *const fragments[] = {
+        "a", "let", "1", "5", ".", "x", "1.5", " ", "\n", "=", "==", "<", "-", ">", "/", "//c", "\"", "\"s\"", ";", "@",
+    };
+    const size_t fragment_count = sizeof(fragments) / sizeof(fragments[0]);
+    char old_input[256], insert[64], new_input[320];
+    uint32_t state = 15;
+
+    // A number before an error token re-lexes when the byte after the error becomes a digit
+    if (!lexer_relex_matches("a 1.x b", "a 1.5 b", (LexerEdit) {4, 5, 5})) {
+        fprintf(stderr, "relex mismatch: \"a 1.x b\" -> \"a 1.5 b\"\n");
+        return 1;
+    }
+    for (long n = 0; n < cases; n++) {
+        size_t parts[2] = {1, 0}, lengths[2] = {0, 0};
+        char *texts[2] = {old_input, insert};
+        state = state * 1103515245u + 12345u;
+        parts[0] += (state >> 16) % 12;
+        state = state * 1103515245u + 12345u;
+        parts[1] = (state >> 16) % 4;
+        for (int t = 0; t < 2; t++) {
+            texts[t][0] = '\0';
+            for (size_t i = 0; i < parts[t]; i++) {
+                state = state * 1103515245u + 12345u;
+                strcat(texts[t], fragments[(state >> 16) % fragment_count]);
+            }
+            lengths[t] = strlen(texts[t]);
+        }
+
+        LexerEdit edit;
+        state = state * 1103515245u + 12345u;
+        edit.start = (state >> 16) % (lengths[0] + 1);
+        state = state * 1103515245u + 12345u;
+        edit.old_end = edit.start + (state >> 16) % (lengths[0] - edit.start + 1);
+        edit.new_end = edit.start + lengths[1];
+        snprintf(new_input, sizeof(new_input), "%.*s%s%s", (int) edit.start, old_input, insert, old_input + edit.old_end);
+        if (!lexer_relex_matches(old_input, new_input, edit)) {
+            fprintf(stderr, "relex mismatch: \"%s\" -> \"%s\" (edit %zu..%zu -> %zu)\n", old_input, new_input,
+                    edit.start, edit.old_end, edit.new_end);
+            return 1;
+        }
+    }
+    printf("lexer_relex matches a fresh lex on %ld edits\n", cases + 1);
+    return 0;
+}
+
+// Main function for testing (optional argument: dialect keyword file)
+// Usage: Lexer [KEYWORD_FILE] | Lexer --bench CORPUS [ITERATIONS] [KEYWORD_FILE]
+//        | Lexer --emit-tokens SOURCE OUTPUT [KEYWORD_FILE] | Lexer --relex-fuzz [CASES]
+int main(int argc, char **argv) {
     const char *code = "function test(var x) { return x + 1; }";
     Lexer lexer;
+    KeywordTable dialect;
     lexer_init(&lexer, code);
 
+    if (argc > 1 && strcmp(argv[1], "--relex-fuzz") == 0) {
+        return lexer_relex_fuzz(argc > 2 ? atol(argv[2]) : 20000);
+    }
+
+    if (argc > 2 && strcmp(argv[1], "--bench") == 0) {
+        int status, iterations = argc > 3 ? atoi(argv[3]) : 5;
+        if (argc <= 4) {
+            return lexer_bench(argv[2], iterations, &keyword_builtin);
+        }
+        if (keyword_table_load(&dialect, &keyword_builtin, argv[4]) != 0) {
+            fprintf(stderr, "Cannot load keyword file %s\n", argv[4]);
+            return 1;
+        }
+        status = lexer_bench(argv[2], iterations, &dialect);
+        keyword_table_free_loaded(&dialect, &keyword_builtin);
+        return status;
+    }
+
+    if (argc > 3 && strcmp(argv[1], "--emit-tokens") == 0) {
+        int status;
+        if (argc <= 4) {
+            return lexer_emit_tokens(argv[2], argv[3], &keyword_builtin);
+        }
+        if (keyword_table_load(&dialect, &keyword_builtin, argv[4]) != 0) {
+            fprintf(stderr, "Cannot load keyword file %s\n", argv[4]);
+            return 1;
+        }
+        status = lexer_emit_tokens(argv[2], argv[3], &dialect);
+        keyword_table_free_loaded(&dialect, &keyword_builtin);
+        return status;
+    }
+
+    if (argc > 1) {
+        if (keyword_table_load(&dialect, &keyword_builtin, argv[1]) != 0) {
+            fprintf(stderr, "Cannot load keyword file %s\n", argv[1]);
+            return 1;
+        }
+        lexer_set_keywords(&lexer, &dialect);
+    }
+
+#ifdef LEXER_COPY_TOKENS
     Token token;
     do {
         token = lexer_next_token(&lexer);
         printf("Token: %s (Type: %d)\n", token.value, token.type);
     } while (token.type != TOKEN_EOF);
+#else
+    TokenView view;
+    do {
+        view = lexer_next_view(&lexer);
+        printf("Token: %.*s (Type: %d)\n", (int) view.length, lexer_token_text(&lexer, &view), view.type);
+    } while (view.type != TOKEN_EOF);
+#endif
 
+    if (argc > 1) {
+        keyword_table_free_loaded(&dialect, &keyword_builtin);
+    }
     return 0;
 }
@@ -1,10 +1,20 @@
-use std::collections::HashMap;
+use std::alloc::{GlobalAlloc, Layout, System};
+use std::cell::Cell;
+use std::collections::{HashMap, VecDeque};
+use std::fmt;
 use std::fs::File;
-use std::io::{self, BufRead, BufReader};
+use std::hash::{BuildHasherDefault, Hasher};
+use std::io::{self, Read};
 use std::path::Path;
+use std::sync::atomic::{AtomicUsize, Ordering};
+use std::sync::{Mutex, OnceLock, RwLock};
+use std::time::{Duration, Instant};
+
+// Keyword perfect hash tables generated by gen_keywords.c (shared with Lexer.c)
+include!("keywords.rs");
 
 // Token types
-#[derive(Debug, Clone, PartialEq)]
+#[derive(Debug, Clone, Copy, PartialEq)]
 enum TokenType {
     Identifier,
     Keyword,
@@ -13,53 +23,483 @@ enum TokenType {
     Separator,
     Comment,
     Whitespace,
+    Eof,
 }
 
-// Token structure
-#[derive(Debug, Clone)]
+// Token structure; the token text is interned. Line and column are 1-based, the column
+// counted in bytes from the start of the line; offset is the byte position in the source.
+#[derive(Debug, Clone, PartialEq)]
 struct Token {
     token_type: TokenType,
-    value: String,
+    value: Symbol,
     line: usize,
     column: usize,
+    offset: usize,
+}
+
+// FNV-1a hasher for the interner and Symbol-keyed maps (small keys, no DoS exposure)
+#[derive(Default)]
+struct FnvHasher(u64);
+
+impl Hasher for FnvHasher {
+    fn write(&mut self, bytes: &[u8]) {
+        let mut h = if self.0 == 0 { 0xcbf29ce484222325 } else { self.0 };
+        for &b in bytes {
+            h ^= b as u64;
+            h = h.wrapping_mul(0x100000001b3);
+        }
+        self.0 = h;
+    }
+
+    fn finish(&self) -> u64 {
+        self.0
+    }
+}
+
+type FnvBuildHasher = BuildHasherDefault<FnvHasher>;
+
+// Interned string id, shared by tokens, the AST, symbol tables and IR
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash, PartialOrd, Ord)]
+struct Symbol(u32);
+
+// Strings with fixed ids (see sym), so the parser can compare punctuation and keywords as integers
+const PREDEFINED_SYMBOLS: [&str; 26] = [
+    "fn", "let", "(", ")", "{", "}", ",", ";", ":", "->", "=", "==", "!=", "<", "<=", ">", ">=", "+", "-", "*",
+    "/", "!", "void", "EOF", "0", "1",
+];
+
+// Symbols of PREDEFINED_SYMBOLS, by position
+#[allow(dead_code)]
+mod sym {
+    use super::Symbol;
+
+    pub const FN: Symbol = Symbol(0);
+    pub const LET: Symbol = Symbol(1);
+    pub const LEFT_PAREN: Symbol = Symbol(2);
+    pub const RIGHT_PAREN: Symbol = Symbol(3);
+    pub const LEFT_BRACE: Symbol = Symbol(4);
+    pub const RIGHT_BRACE: Symbol = Symbol(5);
+    pub const COMMA: Symbol = Symbol(6);
+    pub const SEMICOLON: Symbol = Symbol(7);
+    pub const COLON: Symbol = Symbol(8);
+    pub const ARROW: Symbol = Symbol(9);
+    pub const ASSIGN: Symbol = Symbol(10);
+    pub const EQUAL: Symbol = Symbol(11);
+    pub const NOT_EQUAL: Symbol = Symbol(12);
+    pub const LESS: Symbol = Symbol(13);
+    pub const LESS_EQUAL: Symbol = Symbol(14);
+    pub const GREATER: Symbol = Symbol(15);
+    pub const GREATER_EQUAL: Symbol = Symbol(16);
+    pub const PLUS: Symbol = Symbol(17);
+    pub const MINUS: Symbol = Symbol(18);
+    pub const STAR: Symbol = Symbol(19);
+    pub const SLASH: Symbol = Symbol(20);
+    pub const BANG: Symbol = Symbol(21);
+    pub const VOID: Symbol = Symbol(22);
+    pub const EOF: Symbol = Symbol(23);
+    pub const ZERO: Symbol = Symbol(24);
+    pub const ONE: Symbol = Symbol(25);
+}
+
+const INTERNER_SHARD_BITS: u32 = 4;
+const INTERNER_SHARDS: usize = 1 << INTERNER_SHARD_BITS;
+
+#[derive(Default)]
+struct InternerShard {
+    map: HashMap<&'static str, Symbol, FnvBuildHasher>,
+    strings: Vec<&'static str>,
+}
+
+// Process-wide string interner. Each distinct string is stored once, for the life of the
+// process, and named by a Symbol. The table is split into shards by hash, so parallel
+// compiles rarely contend, and lookups of known strings only take a shard's read lock.
+// Symbol ids: predefined strings first, then (index in shard << SHARD_BITS | shard).
+struct Interner {
+    shards: Vec<RwLock<InternerShard>>,
+}
+
+impl Interner {
+    fn new() -> Interner {
+        let mut shards: Vec<InternerShard> = (0..INTERNER_SHARDS).map(|_| InternerShard::default()).collect();
+        for (i, text) in PREDEFINED_SYMBOLS.iter().enumerate() {
+            shards[Self::shard_of(text)].map.insert(text, Symbol(i as u32));
+        }
+        Interner {
+            shards: shards.into_iter().map(RwLock::new).collect(),
+        }
+    }
+
+    fn shard_of(text: &str) -> usize {
+        let mut hasher = FnvHasher::default();
+        hasher.write(text.as_bytes());
+        (hasher.finish() >> 59) as usize & (INTERNER_SHARDS - 1)
+    }
+
+    fn intern(&self, text: &str) -> Symbol {
+        let shard_index = Self::shard_of(text);
+        let shard = &self.shards[shard_index];
+        if let Some(&symbol) = shard.read().unwrap().map.get(text) {
+            return symbol;
+        }
+
+        let mut shard = shard.write().unwrap();
+        if let Some(&symbol) = shard.map.get(text) {
+            return symbol;
+        }
+        let local = shard.strings.len() as u32;
+        let symbol = Symbol(PREDEFINED_SYMBOLS.len() as u32 + ((local << INTERNER_SHARD_BITS) | shard_index as u32));
+        let stored: &'static str = Box::leak(text.into());
+        shard.strings.push(stored);
+        shard.map.insert(stored, symbol);
+        symbol
+    }
+
+    fn resolve(&self, symbol: Symbol) -> &'static str {
+        let id = symbol.0 as usize;
+        if id < PREDEFINED_SYMBOLS.len() {
+            return PREDEFINED_SYMBOLS[id];
+        }
+        let id = id - PREDEFINED_SYMBOLS.len();
+        self.shards[id & (INTERNER_SHARDS - 1)].read().unwrap().strings[id >> INTERNER_SHARD_BITS]
+    }
+}
+
+fn interner() -> &'static Interner {
+    static INTERNER: OnceLock<Interner> = OnceLock::new();
+    INTERNER.get_or_init(Interner::new)
+}
+
+impl Symbol {
+    fn intern(text: &str) -> Symbol {
+        interner().intern(text)
+    }
+
+    fn as_str(self) -> &'static str {
+        interner().resolve(self)
+    }
+}
+
+impl fmt::Display for Symbol {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        f.write_str(self.as_str())
+    }
+}
+
+// Symbol table: declared name -> type, both interned
+type SymbolTable = HashMap<Symbol, Symbol, FnvBuildHasher>;
+
+// Binary operators
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum BinaryOp {
+    Assign,
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+}
+
+impl BinaryOp {
+    fn as_str(self) -> &'static str {
+        match self {
+            BinaryOp::Assign => "=",
+            BinaryOp::Equal => "==",
+            BinaryOp::NotEqual => "!=",
+            BinaryOp::Less => "<",
+            BinaryOp::LessEqual => "<=",
+            BinaryOp::Greater => ">",
+            BinaryOp::GreaterEqual => ">=",
+            BinaryOp::Add => "+",
+            BinaryOp::Subtract => "-",
+            BinaryOp::Multiply => "*",
+            BinaryOp::Divide => "/",
+        }
+    }
+}
+
+// Unary operators
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum UnaryOp {
+    Not,
+    Negate,
+}
+
+impl UnaryOp {
+    fn from_symbol(symbol: Symbol) -> Option<UnaryOp> {
+        match symbol {
+            sym::BANG => Some(UnaryOp::Not),
+            sym::MINUS => Some(UnaryOp::Negate),
+            _ => None,
+        }
+    }
+
+    fn as_str(self) -> &'static str {
+        match self {
+            UnaryOp::Not => "!",
+            UnaryOp::Negate => "-",
+        }
+    }
+}
+
+// Index of a node in Ast.nodes
+#[derive(Debug, Clone, Copy, PartialEq, Eq, Hash)]
+struct NodeId(u32);
+
+// Contiguous run of child ids in Ast.lists
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct NodeList {
+    start: u32,
+    len: u32,
 }
 
-// Abstract Syntax Tree Node
-#[derive(Debug)]
+// Abstract Syntax Tree Node. Children are NodeIds into the owning Ast; names are Symbols.
+#[derive(Debug, Clone, Copy)]
 enum ASTNode {
-    Program(Vec<ASTNode>),
+    Program(NodeList),
     FunctionDeclaration {
-        name: String,
-        parameters: Vec<ASTNode>,
-        return_type: Box<ASTNode>,
-        body: Box<ASTNode>,
+        name: Symbol,
+        parameters: NodeList,
+        return_type: NodeId,
+        body: NodeId,
     },
     VariableDeclaration {
-        name: String,
-        var_type: Box<ASTNode>,
-        initializer: Option<Box<ASTNode>>,
+        name: Symbol,
+        var_type: NodeId,
+        initializer: Option<NodeId>,
     },
-    Type(String),
-    Block(Vec<ASTNode>),
-    Expression(Box<ASTNode>),
+    Type(Symbol),
+    Block(NodeList),
+    Expression(NodeId),
     BinaryOperation {
-        left: Box<ASTNode>,
-        operator: String,
-        right: Box<ASTNode>,
+        left: NodeId,
+        operator: BinaryOp,
+        right: NodeId,
     },
     UnaryOperation {
-        operator: String,
-        operand: Box<ASTNode>,
+        operator: UnaryOp,
+        operand: NodeId,
     },
-    Literal(String),
-    Identifier(String),
+    Literal(Symbol),
+    Identifier(Symbol),
+}
+
+// Arena-allocated AST: all nodes in one vector, children before parents, freed in one drop
+#[derive(Debug, Default)]
+struct Ast {
+    nodes: Vec<ASTNode>,
+    lists: Vec<NodeId>,
+    root: Option<NodeId>,
+}
+
+impl Ast {
+    fn push(&mut self, node: ASTNode) -> NodeId {
+        let id = NodeId(self.nodes.len() as u32);
+        self.nodes.push(node);
+        id
+    }
+
+    fn push_list(&mut self, children: &[NodeId]) -> NodeList {
+        let start = self.lists.len() as u32;
+        self.lists.extend_from_slice(children);
+        NodeList {
+            start,
+            len: children.len() as u32,
+        }
+    }
+
+    fn node(&self, id: NodeId) -> &ASTNode {
+        &self.nodes[id.0 as usize]
+    }
+
+    fn node_mut(&mut self, id: NodeId) -> &mut ASTNode {
+        &mut self.nodes[id.0 as usize]
+    }
+
+    fn list(&self, list: NodeList) -> &[NodeId] {
+        &self.lists[list.start as usize..(list.start + list.len) as usize]
+    }
+
+    // Keep the children for which `keep` holds, compacting the list in place
+    fn retain_list(&mut self, list: NodeList, mut keep: impl FnMut(&Ast, NodeId) -> bool) -> NodeList {
+        let mut len = 0;
+        for i in 0..list.len {
+            let child = self.lists[(list.start + i) as usize];
+            if keep(self, child) {
+                self.lists[(list.start + len) as usize] = child;
+                len += 1;
+            }
+        }
+        NodeList { start: list.start, len }
+    }
+
+    fn root(&self) -> NodeId {
+        self.root.expect("AST has no root")
+    }
+
+    // Indented tree dump, one node per line
+    fn dump(&self) -> String {
+        let mut out = String::new();
+        if let Some(root) = self.root {
+            self.dump_node(root, 0, &mut out);
+        }
+        out
+    }
+
+    fn dump_node(&self, id: NodeId, depth: usize, out: &mut String) {
+        let indent = "  ".repeat(depth);
+        let children: Vec<NodeId> = match *self.node(id) {
+            ASTNode::Program(list) => {
+                out.push_str(&format!("{}Program\n", indent));
+                self.list(list).to_vec()
+            }
+            ASTNode::FunctionDeclaration { name, parameters, return_type, body } => {
+                out.push_str(&format!("{}FunctionDeclaration {}\n", indent, name));
+                let mut children = self.list(parameters).to_vec();
+                children.push(return_type);
+                children.push(body);
+                children
+            }
+            ASTNode::VariableDeclaration { name, var_type, initializer } => {
+                out.push_str(&format!("{}VariableDeclaration {}\n", indent, name));
+                std::iter::once(var_type).chain(initializer).collect()
+            }
+            ASTNode::Type(name) => {
+                out.push_str(&format!("{}Type {}\n", indent, name));
+                Vec::new()
+            }
+            ASTNode::Block(list) => {
+                out.push_str(&format!("{}Block\n", indent));
+                self.list(list).to_vec()
+            }
+            ASTNode::Expression(expr) => {
+                out.push_str(&format!("{}Expression\n", indent));
+                vec![expr]
+            }
+            ASTNode::BinaryOperation { left, operator, right } => {
+                out.push_str(&format!("{}BinaryOperation {}\n", indent, operator.as_str()));
+                vec![left, right]
+            }
+            ASTNode::UnaryOperation { operator, operand } => {
+                out.push_str(&format!("{}UnaryOperation {}\n", indent, operator.as_str()));
+                vec![operand]
+            }
+            ASTNode::Literal(value) => {
+                out.push_str(&format!("{}Literal {}\n", indent, value));
+                Vec::new()
+            }
+            ASTNode::Identifier(name) => {
+                out.push_str(&format!("{}Identifier {}\n", indent, name));
+                Vec::new()
+            }
+        };
+        for child in children {
+            self.dump_node(child, depth + 1, out);
+        }
+    }
+}
+
+// Operator precedence table: binding powers, loosest first. Prefix operators bind tighter
+// than any infix operator
+const PREC_ASSIGNMENT: u8 = 1;
+const PREC_EQUALITY: u8 = 2;
+const PREC_COMPARISON: u8 = 3;
+const PREC_TERM: u8 = 4;
+const PREC_FACTOR: u8 = 5;
+const PREC_PREFIX: u8 = 6;
+
+// Nesting limit for parenthesized, prefix and right-associative operands, so generated
+// input gets a diagnostic rather than a stack overflow (worker threads have 2 MiB stacks)
+const MAX_EXPRESSION_DEPTH: usize = 2048;
+
+// How a binary operator token parses
+#[derive(Debug, Clone, Copy)]
+struct InfixRule {
+    precedence: u8,
+    operator: BinaryOp,
+    right_assoc: bool,
 }
 
+// Infix rules indexed by operator symbol id; operators are all predefined symbols
+const INFIX_RULES: [Option<InfixRule>; PREDEFINED_SYMBOLS.len()] = {
+    const fn rule(precedence: u8, operator: BinaryOp) -> Option<InfixRule> {
+        Some(InfixRule {
+            precedence,
+            operator,
+            right_assoc: matches!(operator, BinaryOp::Assign),
+        })
+    }
+    let mut rules = [None; PREDEFINED_SYMBOLS.len()];
+    rules[sym::ASSIGN.0 as usize] = rule(PREC_ASSIGNMENT, BinaryOp::Assign);
+    rules[sym::EQUAL.0 as usize] = rule(PREC_EQUALITY, BinaryOp::Equal);
+    rules[sym::NOT_EQUAL.0 as usize] = rule(PREC_EQUALITY, BinaryOp::NotEqual);
+    rules[sym::LESS.0 as usize] = rule(PREC_COMPARISON, BinaryOp::Less);
+    rules[sym::LESS_EQUAL.0 as usize] = rule(PREC_COMPARISON, BinaryOp::LessEqual);
+    rules[sym::GREATER.0 as usize] = rule(PREC_COMPARISON, BinaryOp::Greater);
+    rules[sym::GREATER_EQUAL.0 as usize] = rule(PREC_COMPARISON, BinaryOp::GreaterEqual);
+    rules[sym::PLUS.0 as usize] = rule(PREC_TERM, BinaryOp::Add);
+    rules[sym::MINUS.0 as usize] = rule(PREC_TERM, BinaryOp::Subtract);
+    rules[sym::STAR.0 as usize] = rule(PREC_FACTOR, BinaryOp::Multiply);
+    rules[sym::SLASH.0 as usize] = rule(PREC_FACTOR, BinaryOp::Divide);
+    rules
+};
+
 // Parser structure
 struct Parser {
     tokens: Vec<Token>,
     current: usize,
-    ast: Option<ASTNode>,
+    ast: Ast,
+    // Current expression nesting, bounded by MAX_EXPRESSION_DEPTH
+    depth: usize,
+    // Children of the lists under construction; each list drains its own tail
+    scratch: Vec<NodeId>,
+    diagnostics: Vec<Diagnostic>,
+    // Parsing stops after this many errors; 0 means no limit
+    max_errors: usize,
+}
+
+// Default cap on reported errors per file (--max-errors)
+const DEFAULT_MAX_ERRORS: usize = 20;
+
+// Compiler message; line 0 means the message has no source position
+#[derive(Debug, Clone, PartialEq, Eq)]
+struct Diagnostic {
+    line: usize,
+    column: usize,
+    message: String,
+}
+
+impl Diagnostic {
+    fn new(message: String) -> Self {
+        Diagnostic { line: 0, column: 0, message }
+    }
+
+    fn at(line: usize, column: usize, message: String) -> Self {
+        Diagnostic { line, column, message }
+    }
+
+    // "file:line:column: message", or "file: message" without a position
+    fn render(&self, file: &str) -> String {
+        if self.line > 0 {
+            format!("{}:{}", file, self)
+        } else {
+            format!("{}: {}", file, self)
+        }
+    }
+}
+
+impl fmt::Display for Diagnostic {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        if self.line > 0 {
+            write!(f, "{}:{}: {}", self.line, self.column, self.message)
+        } else {
+            f.write_str(&self.message)
+        }
+    }
 }
 
 impl Parser {
@@ -67,259 +507,282 @@ impl Parser {
         Parser {
             tokens,
             current: 0,
-            ast: None,
+            ast: Ast::default(),
+            depth: 0,
+            scratch: Vec::new(),
+            diagnostics: Vec::new(),
+            max_errors: DEFAULT_MAX_ERRORS,
         }
     }
 
-    fn parse(&mut self) -> Result<ASTNode, String> {
-        let mut program_nodes = Vec::new();
+    fn with_max_errors(mut self, max_errors: usize) -> Self {
+        self.max_errors = max_errors;
+        self
+    }
 
-        while !self.is_at_end() {
+    // Parse the whole token stream. Errors are recovered from in panic mode, so one pass
+    // reports every error (up to max_errors) instead of only the first.
+    fn parse(mut self) -> Result<Ast, Vec<Diagnostic>> {
+        let mark = self.scratch.len();
+
+        while !self.is_at_end() && !self.too_many_errors() {
             match self.parse_declaration() {
-                Ok(node) => program_nodes.push(node),
-                Err(e) => return Err(e),
+                Ok(node) => self.scratch.push(node),
+                Err(message) => {
+                    self.report(message);
+                    self.synchronize(false);
+                }
+            }
+        }
+        if !self.diagnostics.is_empty() {
+            if self.too_many_errors() && !self.is_at_end() {
+                let token = &self.tokens[self.current];
+                let note = format!("too many errors ({}), stopping", self.max_errors);
+                self.diagnostics.push(Diagnostic::at(token.line, token.column, note));
+            }
+            return Err(self.diagnostics);
+        }
+
+        let program = self.finish_list(mark);
+        let root = self.ast.push(ASTNode::Program(program));
+        self.ast.root = Some(root);
+        Ok(self.ast)
+    }
+
+    // Record an error at the current token; errors past the cap are dropped
+    fn report(&mut self, message: String) {
+        if self.too_many_errors() {
+            return;
+        }
+        let token = &self.tokens[self.current.min(self.tokens.len() - 1)];
+        self.diagnostics.push(Diagnostic::at(token.line, token.column, format!("parser error: {}", message)));
+    }
+
+    fn too_many_errors(&self) -> bool {
+        self.max_errors != 0 && self.diagnostics.len() >= self.max_errors
+    }
+
+    // Panic-mode recovery: skip to just past a `;`, or to a declaration keyword or a `}`
+    // (left for the enclosing block when `in_block`, consumed at top level). Stopping at a
+    // keyword always makes progress: errors are never raised before consuming `fn`/`let`.
+    fn synchronize(&mut self, in_block: bool) {
+        while !self.is_at_end() {
+            if self.check(TokenType::Keyword, sym::FN) || self.check(TokenType::Keyword, sym::LET) {
+                return;
+            }
+            if self.check(TokenType::Separator, sym::RIGHT_BRACE) {
+                if !in_block {
+                    self.advance();
+                }
+                return;
+            }
+            if self.advance().token_type == TokenType::Separator && self.previous().value == sym::SEMICOLON {
+                return;
             }
         }
+    }
 
-        self.ast = Some(ASTNode::Program(program_nodes));
-        Ok(self.ast.clone().unwrap())
+    // Move the children pushed since `mark` into the arena as one contiguous list
+    fn finish_list(&mut self, mark: usize) -> NodeList {
+        let list = self.ast.push_list(&self.scratch[mark..]);
+        self.scratch.truncate(mark);
+        list
     }
 
-    fn parse_declaration(&mut self) -> Result<ASTNode, String> {
-        if self.match_token(TokenType::Keyword, "fn") {
+    fn parse_declaration(&mut self) -> Result<NodeId, String> {
+        if self.match_token(TokenType::Keyword, sym::FN) {
             self.parse_function_declaration()
-        } else if self.match_token(TokenType::Keyword, "let") {
+        } else if self.match_token(TokenType::Keyword, sym::LET) {
             self.parse_variable_declaration()
         } else {
             Err("Expected declaration".to_string())
         }
     }
 
-    fn parse_function_declaration(&mut self) -> Result<ASTNode, String> {
+    fn parse_function_declaration(&mut self) -> Result<NodeId, String> {
         let name = self.expect_identifier()?;
-        self.expect_token(TokenType::Separator, "(")?;
+        self.expect_token(TokenType::Separator, sym::LEFT_PAREN)?;
         let parameters = self.parse_parameters()?;
-        self.expect_token(TokenType::Separator, ")")?;
-        self.expect_token(TokenType::Separator, "->")?;
-        let return_type = Box::new(self.parse_type()?);
-        let body = Box::new(self.parse_block()?);
+        self.expect_token(TokenType::Separator, sym::RIGHT_PAREN)?;
+        self.expect_token(TokenType::Separator, sym::ARROW)?;
+        let return_type = self.parse_type()?;
+        let body = self.parse_block()?;
 
-        Ok(ASTNode::FunctionDeclaration {
+        Ok(self.ast.push(ASTNode::FunctionDeclaration {
             name,
             parameters,
             return_type,
             body,
-        })
+        }))
     }
 
-    fn parse_parameters(&mut self) -> Result<Vec<ASTNode>, String> {
-        let mut parameters = Vec::new();
+    fn parse_parameters(&mut self) -> Result<NodeList, String> {
+        let mark = self.scratch.len();
 
-        if !self.check(TokenType::Separator, ")") {
+        if !self.check(TokenType::Separator, sym::RIGHT_PAREN) {
             loop {
                 let param_name = self.expect_identifier()?;
-                self.expect_token(TokenType::Separator, ":")?;
+                self.expect_token(TokenType::Separator, sym::COLON)?;
                 let param_type = self.parse_type()?;
-                parameters.push(ASTNode::VariableDeclaration {
+                let param = self.ast.push(ASTNode::VariableDeclaration {
                     name: param_name,
-                    var_type: Box::new(param_type),
+                    var_type: param_type,
                     initializer: None,
                 });
+                self.scratch.push(param);
 
-                if !self.match_token(TokenType::Separator, ",") {
+                if !self.match_token(TokenType::Separator, sym::COMMA) {
                     break;
                 }
             }
         }
 
-        Ok(parameters)
+        Ok(self.finish_list(mark))
     }
 
-    fn parse_type(&mut self) -> Result<ASTNode, String> {
+    fn parse_type(&mut self) -> Result<NodeId, String> {
         let type_name = self.expect_identifier()?;
-        Ok(ASTNode::Type(type_name))
+        Ok(self.ast.push(ASTNode::Type(type_name)))
     }
 
-    fn parse_block(&mut self) -> Result<ASTNode, String> {
-        self.expect_token(TokenType::Separator, "{")?;
-        let mut statements = Vec::new();
+    fn parse_block(&mut self) -> Result<NodeId, String> {
+        self.expect_token(TokenType::Separator, sym::LEFT_BRACE)?;
+        let mark = self.scratch.len();
 
-        while !self.check(TokenType::Separator, "}") && !self.is_at_end() {
-            statements.push(self.parse_statement()?);
+        // A `fn` cannot start a statement: the block is missing its `}`
+        while !self.check(TokenType::Separator, sym::RIGHT_BRACE)
+            && !self.check(TokenType::Keyword, sym::FN)
+            && !self.is_at_end()
+            && !self.too_many_errors()
+        {
+            match self.parse_statement() {
+                Ok(statement) => self.scratch.push(statement),
+                Err(message) => {
+                    self.report(message);
+                    self.synchronize(true);
+                }
+            }
         }
 
-        self.expect_token(TokenType::Separator, "}")?;
-        Ok(ASTNode::Block(statements))
+        self.expect_token(TokenType::Separator, sym::RIGHT_BRACE)?;
+        let statements = self.finish_list(mark);
+        Ok(self.ast.push(ASTNode::Block(statements)))
     }
 
-    fn parse_statement(&mut self) -> Result<ASTNode, String> {
-        if self.match_token(TokenType::Keyword, "let") {
+    fn parse_statement(&mut self) -> Result<NodeId, String> {
+        if self.match_token(TokenType::Keyword, sym::LET) {
             self.parse_variable_declaration()
         } else {
             self.parse_expression_statement()
         }
     }
 
-    fn parse_variable_declaration(&mut self) -> Result<ASTNode, String> {
+    fn parse_variable_declaration(&mut self) -> Result<NodeId, String> {
         let name = self.expect_identifier()?;
-        self.expect_token(TokenType::Separator, ":")?;
-        let var_type = Box::new(self.parse_type()?);
+        self.expect_token(TokenType::Separator, sym::COLON)?;
+        let var_type = self.parse_type()?;
 
-        let initializer = if self.match_token(TokenType::Operator, "=") {
-            Some(Box::new(self.parse_expression()?))
+        let initializer = if self.match_token(TokenType::Operator, sym::ASSIGN) {
+            Some(self.parse_expression()?)
         } else {
             None
         };
 
-        self.expect_token(TokenType::Separator, ";")?;
+        self.expect_token(TokenType::Separator, sym::SEMICOLON)?;
 
-        Ok(ASTNode::VariableDeclaration {
+        Ok(self.ast.push(ASTNode::VariableDeclaration {
             name,
             var_type,
             initializer,
-        })
+        }))
     }
 
-    fn parse_expression_statement(&mut self) -> Result<ASTNode, String> {
+    fn parse_expression_statement(&mut self) -> Result<NodeId, String> {
         let expr = self.parse_expression()?;
-        self.expect_token(TokenType::Separator, ";")?;
-        Ok(ASTNode::Expression(Box::new(expr)))
-    }
-
-    fn parse_expression(&mut self) -> Result<ASTNode, String> {
-        self.parse_assignment()
-    }
-
-    fn parse_assignment(&mut self) -> Result<ASTNode, String> {
-        let expr = self.parse_equality()?;
-
-        if self.match_token(TokenType::Operator, "=") {
-            let value = self.parse_assignment()?;
-            match expr {
-                ASTNode::Identifier(name) => {
-                    Ok(ASTNode::BinaryOperation {
-                        left: Box::new(ASTNode::Identifier(name)),
-                        operator: "=".to_string(),
-                        right: Box::new(value),
-                    })
-                }
-                _ => Err("Invalid assignment target".to_string()),
-            }
-        } else {
-            Ok(expr)
-        }
+        self.expect_token(TokenType::Separator, sym::SEMICOLON)?;
+        Ok(self.ast.push(ASTNode::Expression(expr)))
     }
 
-    fn parse_equality(&mut self) -> Result<ASTNode, String> {
-        let mut expr = self.parse_comparison()?;
-
-        while self.match_any(&[
-            (TokenType::Operator, "=="),
-            (TokenType::Operator, "!="),
-        ]) {
-            let operator = self.previous().value.clone();
-            let right = self.parse_comparison()?;
-            expr = ASTNode::BinaryOperation {
-                left: Box::new(expr),
-                operator,
-                right: Box::new(right),
-            };
-        }
-
-        Ok(expr)
+    fn parse_expression(&mut self) -> Result<NodeId, String> {
+        self.parse_binary(PREC_ASSIGNMENT)
     }
 
-    fn parse_comparison(&mut self) -> Result<ASTNode, String> {
-        let mut expr = self.parse_term()?;
-
-        while self.match_any(&[
-            (TokenType::Operator, ">"),
-            (TokenType::Operator, ">="),
-            (TokenType::Operator, "<"),
-            (TokenType::Operator, "<="),
-        ]) {
-            let operator = self.previous().value.clone();
-            let right = self.parse_term()?;
-            expr = ASTNode::BinaryOperation {
-                left: Box::new(expr),
-                operator,
-                right: Box::new(right),
-            };
+    // Precedence climbing: parse a prefix operand, then fold in every infix operator that
+    // binds at least as tightly as `min_precedence`. One frame per nesting level, instead
+    // of one per grammar level.
+    fn parse_binary(&mut self, min_precedence: u8) -> Result<NodeId, String> {
+        if self.depth >= MAX_EXPRESSION_DEPTH {
+            return Err("Expression nested too deeply".to_string());
         }
-
-        Ok(expr)
+        self.depth += 1;
+        let result = self.parse_binary_inner(min_precedence);
+        self.depth -= 1;
+        result
     }
 
-    fn parse_term(&mut self) -> Result<ASTNode, String> {
-        let mut expr = self.parse_factor()?;
+    fn parse_binary_inner(&mut self, min_precedence: u8) -> Result<NodeId, String> {
+        let mut left = self.parse_prefix()?;
 
-        while self.match_any(&[
-            (TokenType::Operator, "+"),
-            (TokenType::Operator, "-"),
-        ]) {
-            let operator = self.previous().value.clone();
-            let right = self.parse_factor()?;
-            expr = ASTNode::BinaryOperation {
-                left: Box::new(expr),
-                operator,
-                right: Box::new(right),
-            };
+        while let Some(rule) = self.peek_infix() {
+            if rule.precedence < min_precedence {
+                break;
+            }
+            self.advance();
+            let next = if rule.right_assoc { rule.precedence } else { rule.precedence + 1 };
+            let right = self.parse_binary(next)?;
+            if rule.operator == BinaryOp::Assign && !matches!(self.ast.node(left), ASTNode::Identifier(_)) {
+                return Err("Invalid assignment target".to_string());
+            }
+            left = self.ast.push(ASTNode::BinaryOperation {
+                left,
+                operator: rule.operator,
+                right,
+            });
         }
 
-        Ok(expr)
+        Ok(left)
     }
 
-    fn parse_factor(&mut self) -> Result<ASTNode, String> {
-        let mut expr = self.parse_unary()?;
-
-        while self.match_any(&[
-            (TokenType::Operator, "*"),
-            (TokenType::Operator, "/"),
-        ]) {
-            let operator = self.previous().value.clone();
-            let right = self.parse_unary()?;
-            expr = ASTNode::BinaryOperation {
-                left: Box::new(expr),
-                operator,
-                right: Box::new(right),
-            };
+    // Infix rule of the current token, if it is a binary operator
+    fn peek_infix(&self) -> Option<InfixRule> {
+        let token = self.tokens.get(self.current)?;
+        if token.token_type != TokenType::Operator {
+            return None;
         }
-
-        Ok(expr)
+        INFIX_RULES.get(token.value.0 as usize).copied().flatten()
     }
 
-    fn parse_unary(&mut self) -> Result<ASTNode, String> {
-        if self.match_any(&[
-            (TokenType::Operator, "!"),
-            (TokenType::Operator, "-"),
-        ]) {
-            let operator = self.previous().value.clone();
-            let right = self.parse_unary()?;
-            Ok(ASTNode::UnaryOperation {
-                operator,
-                operand: Box::new(right),
-            })
-        } else {
-            self.parse_primary()
+    fn parse_prefix(&mut self) -> Result<NodeId, String> {
+        let token = &self.tokens[self.current];
+        if token.token_type == TokenType::Operator {
+            if let Some(operator) = UnaryOp::from_symbol(token.value) {
+                self.advance();
+                let operand = self.parse_binary(PREC_PREFIX)?;
+                return Ok(self.ast.push(ASTNode::UnaryOperation { operator, operand }));
+            }
         }
+        self.parse_primary()
     }
 
-    fn parse_primary(&mut self) -> Result<ASTNode, String> {
-        if self.match_token(TokenType::Literal, "") {
-            Ok(ASTNode::Literal(self.previous().value.clone()))
-        } else if self.match_token(TokenType::Identifier, "") {
-            Ok(ASTNode::Identifier(self.previous().value.clone()))
-        } else if self.match_token(TokenType::Separator, "(") {
+    fn parse_primary(&mut self) -> Result<NodeId, String> {
+        if self.match_type(TokenType::Literal) {
+            let value = self.previous().value;
+            Ok(self.ast.push(ASTNode::Literal(value)))
+        } else if self.match_type(TokenType::Identifier) {
+            let name = self.previous().value;
+            Ok(self.ast.push(ASTNode::Identifier(name)))
+        } else if self.match_token(TokenType::Separator, sym::LEFT_PAREN) {
             let expr = self.parse_expression()?;
-            self.expect_token(TokenType::Separator, ")")?;
+            self.expect_token(TokenType::Separator, sym::RIGHT_PAREN)?;
             Ok(expr)
         } else {
             Err("Expected expression".to_string())
         }
     }
 
-    fn match_token(&mut self, token_type: TokenType, value: &str) -> bool {
-        if self.check(token_type.clone(), value) {
+    // Match any token of the given type
+    fn match_type(&mut self, token_type: TokenType) -> bool {
+        if !self.is_at_end() && self.tokens[self.current].token_type == token_type {
             self.advance();
             true
         } else {
@@ -327,22 +790,21 @@ impl Parser {
         }
     }
 
-    fn match_any(&mut self, tokens: &[(TokenType, &str)]) -> bool {
-        for (token_type, value) in tokens {
-            if self.check(token_type.clone(), value) {
-                self.advance();
-                return true;
-            }
+    fn match_token(&mut self, token_type: TokenType, value: Symbol) -> bool {
+        if self.check(token_type, value) {
+            self.advance();
+            true
+        } else {
+            false
         }
-        false
     }
 
-    fn check(&self, token_type: TokenType, value: &str) -> bool {
+    fn check(&self, token_type: TokenType, value: Symbol) -> bool {
         if self.is_at_end() {
             false
         } else {
             let token = &self.tokens[self.current];
-            token.token_type == token_type && (value.is_empty() || token.value == value)
+            token.token_type == token_type && token.value == value
         }
     }
 
@@ -354,15 +816,15 @@ impl Parser {
     }
 
     fn is_at_end(&self) -> bool {
-        self.current >= self.tokens.len()
+        self.current >= self.tokens.len() || self.tokens[self.current].token_type == TokenType::Eof
     }
 
     fn previous(&self) -> &Token {
         &self.tokens[self.current - 1]
     }
 
-    fn expect_token(&mut self, token_type: TokenType, value: &str) -> Result<(), String> {
-        if self.check(token_type.clone(), value) {
+    fn expect_token(&mut self, token_type: TokenType, value: Symbol) -> Result<(), String> {
+        if self.check(token_type, value) {
             self.advance();
             Ok(())
         } else {
@@ -370,126 +832,444 @@ impl Parser {
         }
     }
 
-    fn expect_identifier(&mut self) -> Result<String, String> {
-        if self.match_token(TokenType::Identifier, "") {
-            Ok(self.previous().value.clone())
+    fn expect_identifier(&mut self) -> Result<Symbol, String> {
+        if self.match_type(TokenType::Identifier) {
+            Ok(self.previous().value)
         } else {
             Err("Expected identifier".to_string())
         }
     }
 }
 
-// Lexer structure
-struct Lexer {
-    input: String,
-    tokens: Vec<Token>,
-    start: usize,
-    current: usize,
-    line: usize,
+// Perfect hash keyword table, same hash-and-displace scheme as keyword_hash.h
+#[derive(Debug, Clone, Copy)]
+struct KeywordTable {
+    seed: u32,
+    displace: &'static [u32],
+    slots: &'static [i16],
+    words: &'static [&'static str],
 }
 
-impl Lexer {
-    fn new(input: String) -> Self {
-        Lexer {
-            input,
-            tokens: Vec::new(),
-            start: 0,
-            current: 0,
-            line: 1,
+static BUILTIN_KEYWORDS: KeywordTable = KeywordTable {
+    seed: KEYWORD_SEED,
+    displace: &KEYWORD_DISPLACE,
+    slots: &KEYWORD_SLOTS,
+    words: &KEYWORD_WORDS,
+};
+
+// Dialect keyword table, built once at startup by install_keywords
+static DIALECT_KEYWORDS: OnceLock<KeywordTable> = OnceLock::new();
+
+const KEYWORD_MAX_DISPLACE: u32 = 65536;
+const KEYWORD_MAX_SEEDS: u32 = 4096;
+
+impl KeywordTable {
+    fn hash(text: &[u8], seed: u32) -> u32 {
+        let mut h = 2166136261u32 ^ seed;
+        for &b in text {
+            h ^= b as u32;
+            h = h.wrapping_mul(16777619);
         }
+        h
     }
 
-    fn tokenize(&mut self) -> Result<Vec<Token>, String> {
-        while !self.is_at_end() {
-            self.start = self.current;
-            self.scan_token()?;
+    fn slot(mut h: u32, displace: u32, slot_mask: u32) -> usize {
+        h ^= displace;
+        h ^= h >> 16;
+        h = h.wrapping_mul(0x85ebca6b);
+        h ^= h >> 13;
+        h = h.wrapping_mul(0xc2b2ae35);
+        h ^= h >> 16;
+        (h & slot_mask) as usize
+    }
+
+    fn lookup(&self, text: &[u8]) -> Option<usize> {
+        let h = Self::hash(text, self.seed);
+        let bucket = (h as usize) & (self.displace.len() - 1);
+        let slot = Self::slot(h, self.displace[bucket], self.slots.len() as u32 - 1);
+        let index = self.slots[slot];
+        if index >= 0 && self.words[index as usize].as_bytes() == text {
+            Some(index as usize)
+        } else {
+            None
         }
+    }
 
-        self.tokens.push(Token {
-            token_type: TokenType::Separator,
-            value: "EOF".to_string(),
-            line: self.line,
-            column: self.current,
-        });
+    // Build a table over distinct words. The table lives for the rest of the program. None if
+    // no seed below KEYWORD_MAX_SEEDS works, as in keyword_table_build (keyword_hash.h).
+    fn build(words: Vec<String>) -> Option<KeywordTable> {
+        if words.len() > i16::MAX as usize {
+            return None;
+        }
+        let buckets = (words.len() / 4 + 1).next_power_of_two();
+        let slot_count = (words.len() * 2).next_power_of_two();
 
-        Ok(self.tokens.clone())
-    }
+        for seed in 0..KEYWORD_MAX_SEEDS {
+            let hashes: Vec<u32> = words.iter().map(|w| Self::hash(w.as_bytes(), seed)).collect();
+            let mut by_bucket: Vec<Vec<usize>> = vec![Vec::new(); buckets];
+            for (i, h) in hashes.iter().enumerate() {
+                by_bucket[(*h as usize) & (buckets - 1)].push(i);
+            }
 
-    fn scan_token(&mut self) -> Result<(), String> {
-        let c = self.advance();
-        match c {
-            '(' | ')' | '{' | '}' | ',' | ';' | ':' => self.add_token(TokenType::Separator),
-            '+' | '-' | '*' | '/' => self.add_token(TokenType::Operator),
-            '=' => {
-                if self.match_char('=') {
-                    self.add_token(TokenType::Operator);
-                } else {
-                    self.add_token(TokenType::Operator);
+            let mut displace = vec![0u32; buckets];
+            let mut slots = vec![-1i16; slot_count];
+            let mut ok = true;
+            for (bucket, keys) in by_bucket.iter().enumerate() {
+                let placed = (0..KEYWORD_MAX_DISPLACE).find(|&d| {
+                    let mut taken: Vec<usize> = Vec::with_capacity(keys.len());
+                    for &k in keys {
+                        let slot = Self::slot(hashes[k], d, slot_count as u32 - 1);
+                        if slots[slot] >= 0 || taken.contains(&slot) {
+                            return false;
+                        }
+                        taken.push(slot);
+                    }
+                    true
+                });
+                match placed {
+                    Some(d) => {
+                        displace[bucket] = d;
+                        for &k in keys {
+                            slots[Self::slot(hashes[k], d, slot_count as u32 - 1)] = k as i16;
+                        }
+                    }
+                    None => {
+                        ok = false;
+                        break;
+                    }
                 }
             }
-            '!' => {
-                if self.match_char('=') {
-                    self.add_token(TokenType::Operator);
-                } else {
-                    self.add_token(TokenType::Operator);
-                }
+
+            if ok {
+                let words: Vec<&'static str> = words
+                    .into_iter()
+                    .map(|w| &*Box::leak(w.into_boxed_str()))
+                    .collect();
+                return Some(KeywordTable {
+                    seed,
+                    displace: Box::leak(displace.into_boxed_slice()),
+                    slots: Box::leak(slots.into_boxed_slice()),
+                    words: Box::leak(words.into_boxed_slice()),
+                });
             }
-            '<' => {
-                if self.match_char('=') {
-                    self.add_token(TokenType::Operator);
-                } else {
-                    self.add_token(TokenType::Operator);
-                }
+        }
+        None
+    }
+
+    // Load a dialect keyword file (one keyword per line) on top of the built-in set, by the
+    // rules of keyword_table_load (keyword_hash.h), so both lexers accept the same files and
+    // get the same keywords: a keyword runs to the first '\r' or '\n' of its line, empty lines
+    // are skipped, and a line of 255 bytes or more or a repeated keyword is an error.
+    fn load(file_path: &str) -> io::Result<KeywordTable> {
+        let invalid = |line: usize, message: String| {
+            io::Error::new(io::ErrorKind::InvalidData, format!("{}:{}: {}", file_path, line, message))
+        };
+        let bytes = std::fs::read(file_path)?;
+        let mut seen: Vec<&[u8]> = BUILTIN_KEYWORDS.words.iter().map(|w| w.as_bytes()).collect();
+        for (i, line) in bytes.split(|&b| b == b'\n').enumerate() {
+            if line.len() >= 255 {
+                return Err(invalid(i + 1, "line is longer than 254 bytes".to_string()));
             }
-            '>' => {
-                if self.match_char('=') {
-                    self.add_token(TokenType::Operator);
-                } else {
-                    self.add_token(TokenType::Operator);
-                }
+            let word = &line[..line.iter().position(|&b| b == b'\r').unwrap_or(line.len())];
+            if word.is_empty() {
+                continue;
             }
-            '"' => self.string()?,
-            '0'..='9' => self.number(),
-            'a'..='z' | 'A'..='Z' | '_' => self.identifier(),
-            ' ' | '\r' | '\t' => {}
-            '\n' => self.line += 1,
-            '/' => {
-                if self.match_char('/') {
-                    while self.peek() != '\n' && !self.is_at_end() {
-                        self.advance();
-                    }
-                } else {
-                    self.add_token(TokenType::Operator);
-                }
+            if seen.contains(&word) {
+                return Err(invalid(i + 1, format!("duplicate keyword '{}'", String::from_utf8_lossy(word))));
             }
-            _ => return Err(format!("Unexpected character: {}", c)),
+            seen.push(word);
         }
-        Ok(())
+        // A word that is not UTF-8 can never match an identifier, so leaving it out of the
+        // table recognizes the same keywords as the C one
+        let words = seen.iter().filter_map(|w| std::str::from_utf8(w).ok()).map(str::to_string).collect();
+        Self::build(words)
+            .ok_or_else(|| io::Error::new(io::ErrorKind::InvalidData, "cannot build keyword table"))
     }
+}
 
-    fn advance(&mut self) -> char {
-        let c = self.input.chars().nth(self.current).unwrap();
-        self.current += 1;
-        c
+// Keyword table used by every Lexer: the dialect table if one was installed, else the built-in one
+fn keywords() -> &'static KeywordTable {
+    DIALECT_KEYWORDS.get().unwrap_or(&BUILTIN_KEYWORDS)
+}
+
+// Install a dialect keyword file; must run once at startup, before any lexing
+fn install_keywords(file_path: &str) -> io::Result<()> {
+    let table = KeywordTable::load(file_path)?;
+    DIALECT_KEYWORDS
+        .set(table)
+        .map_err(|_| io::Error::new(io::ErrorKind::AlreadyExists, "keyword table already installed"))
+}
+
+// Read-only memory map of an input file (unix); the mapping lives as long as the value
+#[cfg(unix)]
+mod mmap_sys {
+    use std::os::raw::{c_int, c_long, c_void};
+
+    pub const PROT_READ: c_int = 1;
+    pub const MAP_PRIVATE: c_int = 2;
+    pub const MADV_SEQUENTIAL: c_int = 2;
+
+    extern "C" {
+        pub fn mmap(addr: *mut c_void, len: usize, prot: c_int, flags: c_int, fd: c_int, offset: c_long) -> *mut c_void;
+        pub fn munmap(addr: *mut c_void, len: usize) -> c_int;
+        pub fn madvise(addr: *mut c_void, len: usize, advice: c_int) -> c_int;
     }
+}
 
-    fn match_char(&mut self, expected: char) -> bool {
-        if self.is_at_end() {
-            return false;
+// Source text handed to the lexer: a mapped file, or an owned buffer for stdin, pipes and empty files
+enum SourceBuffer {
+    #[cfg(unix)]
+    Mapped { ptr: *const u8, len: usize },
+    Owned(Vec<u8>),
+}
+
+impl SourceBuffer {
+    // Open `file_path` ("-" reads stdin). Regular files are memory-mapped unless `use_mmap` is false.
+    fn open(file_path: &str, use_mmap: bool) -> io::Result<SourceBuffer> {
+        if file_path == "-" {
+            let mut data = Vec::new();
+            io::stdin().lock().read_to_end(&mut data)?;
+            return Ok(SourceBuffer::Owned(data));
+        }
+
+        let mut file = File::open(file_path)?;
+        let metadata = file.metadata()?;
+        if use_mmap && metadata.is_file() && metadata.len() > 0 {
+            if let Some(mapped) = Self::map(&file, metadata.len() as usize) {
+                return Ok(mapped);
+            }
+        }
+
+        // Pipes, devices and mmap failures fall back to a single read
+        let mut data = Vec::with_capacity(if metadata.is_file() { metadata.len() as usize } else { 0 });
+        file.read_to_end(&mut data)?;
+        Ok(SourceBuffer::Owned(data))
+    }
+
+    #[cfg(unix)]
+    fn map(file: &File, len: usize) -> Option<SourceBuffer> {
+        use std::os::unix::io::AsRawFd;
+
+        // SAFETY: a fresh private read-only mapping of `len` bytes of an open file. The input
+        // must not be truncated while it is being compiled.
+        unsafe {
+            let ptr = mmap_sys::mmap(
+                std::ptr::null_mut(),
+                len,
+                mmap_sys::PROT_READ,
+                mmap_sys::MAP_PRIVATE,
+                file.as_raw_fd(),
+                0,
+            );
+            if ptr as isize == -1 {
+                return None;
+            }
+            mmap_sys::madvise(ptr, len, mmap_sys::MADV_SEQUENTIAL);
+            Some(SourceBuffer::Mapped { ptr: ptr as *const u8, len })
+        }
+    }
+
+    #[cfg(not(unix))]
+    fn map(_file: &File, _len: usize) -> Option<SourceBuffer> {
+        None
+    }
+
+    fn as_bytes(&self) -> &[u8] {
+        match self {
+            // SAFETY: the mapping stays valid until drop
+            #[cfg(unix)]
+            SourceBuffer::Mapped { ptr, len } => unsafe { std::slice::from_raw_parts(*ptr, *len) },
+            SourceBuffer::Owned(data) => data,
+        }
+    }
+}
+
+impl Drop for SourceBuffer {
+    fn drop(&mut self) {
+        #[cfg(unix)]
+        if let SourceBuffer::Mapped { ptr, len } = self {
+            // SAFETY: unmapping the region created in SourceBuffer::map
+            unsafe {
+                mmap_sys::munmap(*ptr as *mut _, *len);
+            }
+        }
+    }
+}
+
+// Lexer structure, scanning bytes borrowed from the source buffer
+struct Lexer<'a> {
+    input: &'a [u8],
+    tokens: Vec<Token>,
+    start: usize,
+    start_line: usize,
+    start_column: usize,
+    current: usize,
+    line: usize,
+    // Offset of the first byte of the current line
+    line_start: usize,
+}
+
+// A text edit: bytes [start, old_end) of the old source became [start, new_end) of the new one
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct TextEdit {
+    start: usize,
+    old_end: usize,
+    new_end: usize,
+}
+
+impl<'a> Lexer<'a> {
+    fn new(input: &'a [u8]) -> Self {
+        Lexer {
+            input,
+            tokens: Vec::new(),
+            start: 0,
+            start_line: 1,
+            start_column: 1,
+            current: 0,
+            line: 1,
+            line_start: 0,
+        }
+    }
+
+    // Resume lexing at the start of an existing token. The lexer carries no state between
+    // lexemes, so a token's position is a complete restart point.
+    fn resume_at(input: &'a [u8], token: &Token) -> Self {
+        Lexer {
+            current: token.offset,
+            line: token.line,
+            line_start: token.offset + 1 - token.column,
+            ..Lexer::new(input)
+        }
+    }
+
+    fn tokenize(&mut self) -> Result<Vec<Token>, String> {
+        while !self.is_at_end() {
+            self.begin_lexeme();
+            if let Some(token_type) = self.scan_lexeme()? {
+                self.add_token(token_type);
+            }
+        }
+
+        self.begin_lexeme();
+        self.tokens.push(self.eof_token());
+        Ok(std::mem::take(&mut self.tokens))
+    }
+
+    fn eof_token(&self) -> Token {
+        Token {
+            token_type: TokenType::Eof,
+            value: sym::EOF,
+            line: self.line,
+            column: self.current - self.line_start + 1,
+            offset: self.current,
+        }
+    }
+
+    // Patch `tokens` (the stream of the old source, ending in Eof) after `edit` produced
+    // `input`. Lexing restarts at the last token that begins before the edit and stops as
+    // soon as a new token starts where a shifted old token past the edit started: from
+    // there on the bytes are identical, so the old tail is reused with adjusted positions.
+    // Returns the range of `tokens` that now holds freshly lexed tokens.
+    fn relex(input: &'a [u8], tokens: &mut Vec<Token>, edit: TextEdit) -> Result<std::ops::Range<usize>, String> {
+        let first = tokens.partition_point(|t| t.offset < edit.start).saturating_sub(1);
+        let mut lexer = match tokens.get(first) {
+            Some(token) if token.offset < edit.start => Lexer::resume_at(input, token),
+            _ => Lexer::new(input),
+        };
+        // Old tokens past the edit are the candidates for resynchronizing
+        let tail = tokens.partition_point(|t| t.offset < edit.old_end);
+
+        while !lexer.is_at_end() {
+            lexer.begin_lexeme();
+            let Some(token_type) = lexer.scan_lexeme()? else { continue };
+            if lexer.start >= edit.new_end {
+                let old_offset = lexer.start - edit.new_end + edit.old_end;
+                let sync = tail + tokens[tail..].partition_point(|t| t.offset < old_offset);
+                if tokens.get(sync).map_or(false, |t| t.offset == old_offset && t.token_type != TokenType::Eof) {
+                    let anchor = tokens[sync].clone();
+                    let (new_line, new_column) = (lexer.start_line, lexer.start_column);
+                    for token in &mut tokens[sync..] {
+                        if token.line == anchor.line {
+                            token.column = token.column + new_column - anchor.column;
+                        }
+                        token.line = token.line + new_line - anchor.line;
+                        token.offset = token.offset + edit.new_end - edit.old_end;
+                    }
+                    let count = lexer.tokens.len();
+                    tokens.splice(first..sync, lexer.tokens);
+                    return Ok(first..first + count);
+                }
+            }
+            lexer.add_token(token_type);
         }
-        if self.input.chars().nth(self.current).unwrap() != expected {
+
+        lexer.begin_lexeme();
+        lexer.tokens.push(lexer.eof_token());
+        let count = lexer.tokens.len();
+        tokens.splice(first.., lexer.tokens);
+        Ok(first..first + count)
+    }
+
+    fn begin_lexeme(&mut self) {
+        self.start = self.current;
+        self.start_line = self.line;
+        self.start_column = self.current - self.line_start + 1;
+    }
+
+    // Scan one lexeme starting at self.start; whitespace and comments yield None
+    fn scan_lexeme(&mut self) -> Result<Option<TokenType>, String> {
+        let c = self.advance();
+        let token_type = match c {
+            b'(' | b')' | b'{' | b'}' | b',' | b';' | b':' => TokenType::Separator,
+            b'-' if self.match_char(b'>') => TokenType::Separator,
+            b'+' | b'-' | b'*' => TokenType::Operator,
+            b'=' | b'!' | b'<' | b'>' => {
+                self.match_char(b'=');
+                TokenType::Operator
+            }
+            b'"' => self.string()?,
+            b'0'..=b'9' => self.number(),
+            b'a'..=b'z' | b'A'..=b'Z' | b'_' => self.identifier(),
+            b' ' | b'\r' | b'\t' => return Ok(None),
+            b'\n' => {
+                self.line += 1;
+                self.line_start = self.current;
+                return Ok(None);
+            }
+            b'/' => {
+                if self.match_char(b'/') {
+                    while self.peek() != b'\n' && !self.is_at_end() {
+                        self.advance();
+                    }
+                    return Ok(None);
+                }
+                TokenType::Operator
+            }
+            _ => return Err(format!("Unexpected character: {}", String::from_utf8_lossy(&[c]))),
+        };
+        Ok(Some(token_type))
+    }
+
+    fn advance(&mut self) -> u8 {
+        let c = self.input[self.current];
+        self.current += 1;
+        c
+    }
+
+    fn match_char(&mut self, expected: u8) -> bool {
+        if self.peek() != expected || self.is_at_end() {
             return false;
         }
         self.current += 1;
         true
     }
 
-    fn peek(&self) -> char {
-        if self.is_at_end() {
-            '\0'
-        } else {
-            self.input.chars().nth(self.current).unwrap()
-        }
+    fn peek(&self) -> u8 {
+        self.peek_at(self.current)
+    }
+
+    fn peek_at(&self, index: usize) -> u8 {
+        self.input.get(index).copied().unwrap_or(b'\0')
     }
 
     fn is_at_end(&self) -> bool {
@@ -500,18 +1280,19 @@ impl Lexer {
         let text = &self.input[self.start..self.current];
         self.tokens.push(Token {
             token_type,
-            value: text.to_string(),
-            line: self.line,
-            column: self.start,
+            value: Symbol::intern(&String::from_utf8_lossy(text)),
+            line: self.start_line,
+            column: self.start_column,
+            offset: self.start,
         });
     }
 
-    fn string(&mut self) -> Result<(), String> {
-        while self.peek() != '"' && !self.is_at_end() {
-            if self.peek() == '\n' {
+    fn string(&mut self) -> Result<TokenType, String> {
+        while self.peek() != b'"' && !self.is_at_end() {
+            if self.advance() == b'\n' {
                 self.line += 1;
+                self.line_start = self.current;
             }
-            self.advance();
         }
 
         if self.is_at_end() {
@@ -519,302 +1300,3561 @@ impl Lexer {
         }
 
         self.advance();
-        let value = &self.input[self.start + 1..self.current - 1];
-        self.add_token(TokenType::Literal);
-        Ok(())
+        Ok(TokenType::Literal)
     }
 
-    fn number(&mut self) {
-        while self.peek().is_digit(10) {
+    fn number(&mut self) -> TokenType {
+        while self.peek().is_ascii_digit() {
             self.advance();
         }
 
-        if self.peek() == '.' && self.input.chars().nth(self.current + 1).unwrap().is_digit(10) {
+        if self.peek() == b'.' && self.peek_at(self.current + 1).is_ascii_digit() {
             self.advance();
 
-            while self.peek().is_digit(10) {
+            while self.peek().is_ascii_digit() {
                 self.advance();
             }
         }
 
-        self.add_token(TokenType::Literal);
+        TokenType::Literal
     }
 
-    fn identifier(&mut self) {
-        while self.peek().is_alphanumeric() || self.peek() == '_' {
+    fn identifier(&mut self) -> TokenType {
+        while self.peek().is_ascii_alphanumeric() || self.peek() == b'_' {
             self.advance();
         }
 
         let text = &self.input[self.start..self.current];
-        let token_type = match text {
-            "fn" | "let" | "if" | "else" | "while" | "return" => TokenType::Keyword,
-            _ => TokenType::Identifier,
-        };
-
-        self.add_token(token_type);
+        if keywords().lookup(text).is_some() {
+            TokenType::Keyword
+        } else {
+            TokenType::Identifier
+        }
     }
 }
 
-fn main() -> io::Result<()> {
-    println!("D++ C Parser Initialization");
-    println!("---------------------------");
-
-    // Read input file
-    let file_path = "input.dpp";
-    let file = File::open(file_path)?;
-    let reader = BufReader::new(file);
-    let mut input = String::new();
+// Inputs below this many bytes per thread are lexed serially
+const PARALLEL_LEX_MIN_CHUNK: usize = 1 << 20;
 
-    for line in reader.lines() {
-        input.push_str(&line?);
-        input.push('\n');
+// Pre-scan one piece of the input that begins at a line start, entering it inside a
+// string literal or not. Returns whether it ends inside one. Comments end at their
+// newline, so an open string is the only lexer state that can cross a line break.
+fn scan_string_state(piece: &[u8], mut in_string: bool) -> bool {
+    let mut i = 0;
+    while i < piece.len() {
+        if in_string {
+            match piece[i..].iter().position(|&c| c == b'"') {
+                Some(quote) => i += quote + 1,
+                None => return true,
+            }
+            in_string = false;
+            continue;
+        }
+        match piece[i] {
+            b'"' => in_string = true,
+            b'/' if piece.get(i + 1) == Some(&b'/') => {
+                i += piece[i..].iter().position(|&c| c == b'\n').unwrap_or(piece.len() - i);
+                continue;
+            }
+            _ => {}
+        }
+        i += 1;
     }
+    in_string
+}
 
-    // Initialize lexer
-    let mut lexer = Lexer::new(input);
-    let tokens = match lexer.tokenize() {
-        Ok(t) => t,
-        Err(e) => {
-            eprintln!("Lexer error: {}", e);
-            return Ok(());
-        }
+// Lex `input` on up to `jobs` threads; the result is identical to Lexer::tokenize.
+// The input is cut into pieces at newlines and a parallel pre-scan records, for each
+// piece, its newline count and whether it ends inside a string literal when entered
+// outside one. Folding those in order finds the piece starts that lie outside strings
+// and the line they begin on; the rare piece entered inside a string is rescanned. Each such start is a lexer restart point, so the
+// chunks between them lex concurrently with exact lines, columns and offsets, and the
+// streams are joined by dropping each chunk's Eof but the last. The error reported is
+// the one of the earliest failing chunk, which is where the serial lexer stops too.
+fn tokenize_parallel(input: &[u8], jobs: usize) -> Result<Vec<Token>, Diagnostic> {
+    let lex_chunk = |start: usize, end: usize, line: usize| {
+        let mut lexer = Lexer { current: start, line, line_start: start, ..Lexer::new(&input[..end]) };
+        lexer.tokenize().map_err(|e| Diagnostic::at(lexer.start_line, lexer.start_column, e))
     };
+    let pieces = (jobs * 4).min(input.len() / PARALLEL_LEX_MIN_CHUNK);
+    if jobs <= 1 || pieces < 2 {
+        return lex_chunk(0, input.len(), 1);
+    }
 
-    println!("Tokenization complete. Found {} tokens.", tokens.len());
-
-    // Initialize parser
-    let mut parser = Parser::new(tokens);
-    let ast = match parser.parse() {
-        Ok(a) => a,
-        Err(e) => {
-            eprintln!("Parser error: {}", e);
-            return Ok(());
+    let mut starts = vec![0];
+    for k in 1..pieces {
+        let from = (k * input.len() / pieces).max(*starts.last().unwrap());
+        match input[from..].iter().position(|&c| c == b'\n') {
+            Some(newline) if from + newline + 1 < input.len() => starts.push(from + newline + 1),
+            _ => break,
         }
-    };
-
-    println!("Parsing complete. AST generated.");
+    }
+    let piece_end = |i: usize| starts.get(i + 1).copied().unwrap_or(input.len());
 
-    // Print AST (for demonstration purposes)
-    println!("Abstract Syntax Tree:");
-    println!("{:#?}", ast);
+    let scans = run_parallel(starts.len(), jobs, |i| {
+        let piece = &input[starts[i]..piece_end(i)];
+        (scan_string_state(piece, false), piece.iter().filter(|&&c| c == b'\n').count())
+    });
 
-    println!("D++ C Parser initialization complete.");
-    Ok(())
-}
+    let mut chunks = Vec::new();
+    let (mut in_string, mut line) = (false, 1);
+    for (i, &(ends_in_string, newlines)) in scans.iter().enumerate() {
+        if in_string {
+            in_string = scan_string_state(&input[starts[i]..piece_end(i)], true);
+        } else {
+            chunks.push((starts[i], line));
+            in_string = ends_in_string;
+        }
+        line += newlines;
+    }
 
-// Helper function to read keywords from a file
-fn read_keywords(file_path: &str) -> io::Result<Vec<String>> {
-    let file = File::open(file_path)?;
-    let reader = BufReader::new(file);
-    let mut keywords = Vec::new();
+    let mut streams = run_parallel(chunks.len(), jobs, |i| {
+        let end = chunks.get(i + 1).map_or(input.len(), |&(start, _)| start);
+        lex_chunk(chunks[i].0, end, chunks[i].1)
+    })
+    .into_iter()
+    .collect::<Result<Vec<_>, _>>()?;
+    let last = streams.len() - 1;
+    for stream in &mut streams[..last] {
+        stream.pop();
+    }
 
-    for line in reader.lines() {
-        keywords.push(line?);
+    // Joining is a copy of every token, so each stream moves into its slice in parallel
+    let total = streams.iter().map(Vec::len).sum();
+    let mut tokens: Vec<Token> = Vec::with_capacity(total);
+    let mut targets = Vec::with_capacity(streams.len());
+    let mut spare = &mut tokens.spare_capacity_mut()[..total];
+    for stream in streams {
+        let (target, rest) = spare.split_at_mut(stream.len());
+        targets.push(Mutex::new((target, stream)));
+        spare = rest;
     }
+    run_parallel(targets.len(), jobs, |i| {
+        let (target, stream) = &mut *targets[i].lock().unwrap();
+        for (slot, token) in target.iter_mut().zip(std::mem::take(stream)) {
+            slot.write(token);
+        }
+    });
+    drop(targets);
+    // SAFETY: the targets partition the first `total` slots and every one was written
+    unsafe { tokens.set_len(total) };
+    Ok(tokens)
+}
 
-    Ok(keywords)
+// Command-line options for the driver
+struct Options {
+    inputs: Vec<String>,
+    keywords: Option<String>,
+    use_mmap: bool,
+    jobs: Option<usize>,
+    lex_jobs: usize,
+    dump_ast: bool,
+    dump_ir: bool,
+    emit_asm: bool,
+    opt_level: u8,
+    time_passes: bool,
+    stats: bool,
+    trace: Option<String>,
+    cache_dir: Option<String>,
+    max_errors: usize,
+    emit_tokens: Option<String>,
+    // --edit START:END:TEXT, bytes [START, END) of the input replaced by TEXT
+    edit: Option<(usize, usize, String)>,
+    bench: bool,
+    check_tokens: bool,
+    gen_corpus: Option<String>,
+    corpus: CorpusSpec,
+    iterations: usize,
 }
 
-// Helper function to generate symbol table
-fn generate_symbol_table(ast: &ASTNode) -> HashMap<String, String> {
-    let mut symbol_table = HashMap::new();
-
-    fn traverse_ast(node: &ASTNode, table: &mut HashMap<String, String>) {
-        match node {
-            ASTNode::VariableDeclaration { name, var_type, .. } => {
-                if let ASTNode::Type(type_name) = **var_type {
-                    table.insert(name.clone(), type_name);
-                }
-            }
-            ASTNode::FunctionDeclaration { name, parameters, return_type, .. } => {
-                let mut param_types = Vec::new();
-                for param in parameters {
-                    if let ASTNode::VariableDeclaration { var_type, .. } = param {
-                        if let ASTNode::Type(type_name) = **var_type {
-                            param_types.push(type_name);
-                        }
+impl Options {
+    fn parse(args: &[String]) -> Result<Options, String> {
+        let mut options = Options {
+            inputs: Vec::new(),
+            keywords: None,
+            use_mmap: true,
+            jobs: None,
+            lex_jobs: 1,
+            dump_ast: false,
+            dump_ir: false,
+            emit_asm: false,
+            opt_level: 0,
+            time_passes: false,
+            stats: false,
+            trace: None,
+            cache_dir: None,
+            max_errors: DEFAULT_MAX_ERRORS,
+            emit_tokens: None,
+            edit: None,
+            bench: false,
+            check_tokens: false,
+            gen_corpus: None,
+            corpus: CorpusSpec::default(),
+            iterations: 5,
+        };
+        let mut iter = args.iter().skip(1);
+        while let Some(arg) = iter.next() {
+            match arg.as_str() {
+                "--keywords" => {
+                    options.keywords = Some(iter.next().ok_or("--keywords requires a file argument")?.clone());
+                }
+                "--no-mmap" => options.use_mmap = false,
+                "--cache" => {
+                    options.cache_dir = Some(iter.next().ok_or("--cache requires a directory argument")?.clone());
+                }
+                "--dump-ast" => options.dump_ast = true,
+                "--dump-ir" => options.dump_ir = true,
+                "--emit-asm" => options.emit_asm = true,
+                "--time-passes" => options.time_passes = true,
+                "--stats" => options.stats = true,
+                "--trace" => {
+                    options.trace = Some(iter.next().ok_or("--trace requires an output file")?.clone());
+                }
+                "--max-errors" => {
+                    let value = iter.next().ok_or("--max-errors requires a count (0 for no limit)")?;
+                    options.max_errors = value.parse().map_err(|_| format!("invalid --max-errors value: {}", value))?;
+                }
+                "--emit-tokens" => {
+                    options.emit_tokens = Some(iter.next().ok_or("--emit-tokens requires an output file")?.clone());
+                }
+                "--edit" => {
+                    let value = iter.next().ok_or("--edit requires START:END:TEXT")?;
+                    let mut parts = value.splitn(3, ':');
+                    let mut offset = || parts.next().and_then(|p| p.parse::<usize>().ok());
+                    let (start, end) = match (offset(), offset()) {
+                        (Some(start), Some(end)) if start <= end => (start, end),
+                        _ => return Err(format!("invalid --edit value: {}", value)),
+                    };
+                    options.edit = Some((start, end, parts.next().unwrap_or("").to_string()));
+                }
+                "--bench" => options.bench = true,
+                "--check-tokens" => options.check_tokens = true,
+                "--gen-corpus" => {
+                    options.gen_corpus = Some(iter.next().ok_or("--gen-corpus requires an output file")?.clone());
+                }
+                "--corpus-size" => {
+                    let value = iter.next().ok_or("--corpus-size requires a byte count")?;
+                    options.corpus.size = parse_size(value).ok_or_else(|| format!("invalid --corpus-size value: {}", value))?;
+                }
+                "--corpus-shape" => {
+                    let value = iter.next().ok_or("--corpus-shape requires a shape name")?;
+                    options.corpus.shape = CorpusShape::parse(value).ok_or_else(|| {
+                        format!("invalid --corpus-shape value: {} (program, identifiers, numbers, whitespace or long-lines)", value)
+                    })?;
+                }
+                "--corpus-idents" | "--corpus-depth" | "--corpus-seed" | "--iterations" => {
+                    let value = iter.next().ok_or_else(|| format!("{} requires a number", arg))?;
+                    let number = value.parse::<u64>().map_err(|_| format!("invalid {} value: {}", arg, value))?;
+                    match arg.as_str() {
+                        "--corpus-idents" => options.corpus.idents = number as usize,
+                        "--corpus-depth" => options.corpus.depth = number as usize,
+                        "--corpus-seed" => options.corpus.seed = number,
+                        _ => options.iterations = number as usize,
                     }
                 }
-                let ret_type = if let ASTNode::Type(type_name) = **return_type {
-                    type_name
-                } else {
-                    "void".to_string()
-                };
-                table.insert(name.clone(), format!("fn({}) -> {}", param_types.join(", "), ret_type));
-            }
-            ASTNode::Program(nodes) | ASTNode::Block(nodes) => {
-                for node in nodes {
-                    traverse_ast(node, table);
+                "--jobs" | "-j" => {
+                    let value = iter.next().ok_or("--jobs requires a thread count")?;
+                    let jobs = value.parse::<usize>().map_err(|_| format!("invalid --jobs value: {}", value))?;
+                    options.jobs = Some(jobs.max(1));
+                }
+                "--lex-jobs" => {
+                    let value = iter.next().ok_or("--lex-jobs requires a thread count")?;
+                    let jobs = value.parse::<usize>().map_err(|_| format!("invalid --lex-jobs value: {}", value))?;
+                    // 0 lexes each file on every core
+                    options.lex_jobs = if jobs == 0 { std::thread::available_parallelism().map_or(1, |n| n.get()) } else { jobs };
+                }
+                _ if arg.starts_with("-j") && arg.len() > 2 => {
+                    let jobs = arg[2..].parse::<usize>().map_err(|_| format!("invalid -j value: {}", arg))?;
+                    options.jobs = Some(jobs.max(1));
                 }
+                _ if arg.starts_with("-O") => {
+                    let level = if arg.len() == 2 { Ok(1) } else { arg[2..].parse::<u8>() };
+                    options.opt_level = level.map_err(|_| format!("invalid optimization level: {}", arg))?.min(2);
+                }
+                _ if arg.starts_with('-') && arg != "-" => return Err(format!("unknown option: {}", arg)),
+                _ => options.inputs.push(arg.clone()),
             }
-            _ => {}
         }
+        Ok(options)
     }
 
-    traverse_ast(ast, &mut symbol_table);
-    symbol_table
+    // Multi-file mode: several inputs, a directory or glob, an explicit --jobs or a cache
+    fn is_batch(&self) -> bool {
+        self.jobs.is_some()
+            || self.cache_dir.is_some()
+            || self.inputs.len() > 1
+            || self.inputs.iter().any(|i| i.contains('*') || i.contains('?') || Path::new(i).is_dir())
+    }
 }
 
-// Helper function to perform semantic analysis
-fn semantic_analysis(ast: &ASTNode, symbol_table: &HashMap<String, String>) -> Result<(), String> {
-    fn check_node(node: &ASTNode, table: &HashMap<String, String>) -> Result<(), String> {
-        match node {
-            ASTNode::BinaryOperation { left, operator, right } => {
-                check_node(left, table)?;
-                check_node(right, table)?;
-                // Add type checking for binary operations
-            }
-            ASTNode::UnaryOperation { operator, operand } => {
-                check_node(operand, table)?;
-                // Add type checking for unary operations
-            }
-            ASTNode::Identifier(name) => {
-                if !table.contains_key(name) {
-                    return Err(format!("Undefined variable: {}", name));
-                }
-            }
-            ASTNode::FunctionDeclaration { name, parameters, body, .. } => {
-                // Check function body
-                check_node(body, table)?;
-            }
-            ASTNode::Program(nodes) | ASTNode::Block(nodes) => {
-                for node in nodes {
-                    check_node(node, table)?;
-                }
+// Expand directories (recursively, *.dpp) and `*`/`?` globs in the last path component.
+// Each expansion is sorted, so the file order depends only on the arguments.
+fn expand_inputs(inputs: &[String]) -> io::Result<Vec<String>> {
+    fn walk(dir: &Path, out: &mut Vec<String>) -> io::Result<()> {
+        let mut entries: Vec<_> = std::fs::read_dir(dir)?.collect::<io::Result<Vec<_>>>()?;
+        entries.sort_by_key(|e| e.file_name());
+        for entry in entries {
+            let path = entry.path();
+            if path.is_dir() {
+                walk(&path, out)?;
+            } else if path.extension().map_or(false, |e| e == "dpp") {
+                out.push(path.to_string_lossy().into_owned());
             }
-            _ => {}
         }
         Ok(())
     }
 
-    check_node(ast, symbol_table)
+    fn glob_match(pattern: &[u8], name: &[u8]) -> bool {
+        match (pattern.first(), name.first()) {
+            (None, None) => true,
+            (Some(b'*'), _) => glob_match(&pattern[1..], name) || (!name.is_empty() && glob_match(pattern, &name[1..])),
+            (Some(b'?'), Some(_)) => glob_match(&pattern[1..], &name[1..]),
+            (Some(p), Some(n)) if p == n => glob_match(&pattern[1..], &name[1..]),
+            _ => false,
+        }
+    }
+
+    let mut files = Vec::new();
+    for input in inputs {
+        let path = Path::new(input);
+        if path.is_dir() {
+            walk(path, &mut files)?;
+        } else if input.contains('*') || input.contains('?') {
+            let dir = path.parent().filter(|d| !d.as_os_str().is_empty()).unwrap_or(Path::new("."));
+            let pattern = path.file_name().map(|n| n.to_string_lossy().into_owned()).unwrap_or_default();
+            let mut matched: Vec<String> = std::fs::read_dir(dir)?
+                .filter_map(|e| e.ok())
+                .filter(|e| glob_match(pattern.as_bytes(), e.file_name().to_string_lossy().as_bytes()))
+                .map(|e| e.path().to_string_lossy().into_owned())
+                .collect();
+            matched.sort();
+            files.extend(matched);
+        } else {
+            files.push(input.clone());
+        }
+    }
+    Ok(files)
 }
 
-// Helper function to optimize AST
-fn optimize_ast(ast: &mut ASTNode) {
-    fn optimize_node(node: &mut ASTNode) {
-        match node {
-            ASTNode::BinaryOperation { left, operator, right } => {
-                optimize_node(left);
-                optimize_node(right);
-                // Perform constant folding and other optimizations
-            }
-            ASTNode::UnaryOperation { operand, .. } => {
-                optimize_node(operand);
-            }
-            ASTNode::Program(nodes) | ASTNode::Block(nodes) => {
-                for node in nodes {
-                    optimize_node(node);
-                }
+// Run task(0..count) on `jobs` worker threads with work stealing: each worker pops from the
+// front of its own deque and, once empty, steals from the back of the others. Results come
+// back in index order regardless of scheduling.
+fn run_parallel<T, F>(count: usize, jobs: usize, task: F) -> Vec<T>
+where
+    T: Send,
+    F: Fn(usize) -> T + Sync,
+{
+    let jobs = jobs.clamp(1, count.max(1));
+    let queues: Vec<Mutex<VecDeque<usize>>> = (0..jobs)
+        .map(|w| Mutex::new((w * count / jobs..(w + 1) * count / jobs).collect()))
+        .collect();
+
+    let mut results: Vec<(usize, T)> = std::thread::scope(|scope| {
+        let workers: Vec<_> = (0..jobs)
+            .map(|w| {
+                let queues = &queues;
+                let task = &task;
+                scope.spawn(move || {
+                    let mut done = Vec::new();
+                    loop {
+                        let next = queues[w].lock().unwrap().pop_front().or_else(|| {
+                            (1..jobs).find_map(|k| queues[(w + k) % jobs].lock().unwrap().pop_back())
+                        });
+                        match next {
+                            Some(i) => done.push((i, task(i))),
+                            None => break,
+                        }
+                    }
+                    done
+                })
+            })
+            .collect();
+        workers.into_iter().flat_map(|h| h.join().unwrap()).collect()
+    });
+
+    results.sort_by_key(|(i, _)| *i);
+    results.into_iter().map(|(_, r)| r).collect()
+}
+
+// Allocation counters for --stats. Every thread counts its own allocations, so stages
+// running concurrently in batch mode are attributed correctly; the process-wide live
+// and peak byte counts are shared atomics.
+struct CountingAllocator;
+
+#[derive(Clone, Copy)]
+struct AllocCounters {
+    allocations: u64,
+    allocated: u64,
+    // Live bytes allocated minus freed by this thread (negative if it frees others' memory)
+    live: i64,
+    peak: i64,
+}
+
+thread_local! {
+    static THREAD_ALLOCS: Cell<AllocCounters> = const {
+        Cell::new(AllocCounters { allocations: 0, allocated: 0, live: 0, peak: 0 })
+    };
+}
+
+static PROCESS_LIVE: AtomicUsize = AtomicUsize::new(0);
+static PROCESS_PEAK: AtomicUsize = AtomicUsize::new(0);
+
+impl CountingAllocator {
+    fn record(size: usize, allocation: bool) {
+        let delta = size as i64;
+        // try_with: allocations made while a thread's locals are torn down go uncounted
+        let _ = THREAD_ALLOCS.try_with(|counters| {
+            let mut c = counters.get();
+            if allocation {
+                c.allocations += 1;
+                c.allocated += size as u64;
+                c.live += delta;
+                c.peak = c.peak.max(c.live);
+            } else {
+                c.live -= delta;
             }
-            _ => {}
+            counters.set(c);
+        });
+        if allocation {
+            let live = PROCESS_LIVE.fetch_add(size, Ordering::Relaxed) + size;
+            PROCESS_PEAK.fetch_max(live, Ordering::Relaxed);
+        } else {
+            PROCESS_LIVE.fetch_sub(size, Ordering::Relaxed);
+        }
+    }
+}
+
+unsafe impl GlobalAlloc for CountingAllocator {
+    unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
+        let ptr = System.alloc(layout);
+        if !ptr.is_null() {
+            Self::record(layout.size(), true);
+        }
+        ptr
+    }
+
+    unsafe fn alloc_zeroed(&self, layout: Layout) -> *mut u8 {
+        let ptr = System.alloc_zeroed(layout);
+        if !ptr.is_null() {
+            Self::record(layout.size(), true);
         }
+        ptr
+    }
+
+    unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
+        System.dealloc(ptr, layout);
+        Self::record(layout.size(), false);
     }
 
-    optimize_node(ast);
+    unsafe fn realloc(&self, ptr: *mut u8, layout: Layout, new_size: usize) -> *mut u8 {
+        let new_ptr = System.realloc(ptr, layout, new_size);
+        if !new_ptr.is_null() {
+            Self::record(layout.size(), false);
+            Self::record(new_size, true);
+        }
+        new_ptr
+    }
 }
 
-// Helper function to generate intermediate representation (IR)
-fn generate_ir(ast: &ASTNode) -> Vec<String> {
-    let mut ir = Vec::new();
+#[global_allocator]
+static ALLOCATOR: CountingAllocator = CountingAllocator;
 
-    fn generate_node_ir(node: &ASTNode, ir: &mut Vec<String>) {
-        match node {
-            ASTNode::FunctionDeclaration { name, parameters, body, .. } => {
-                ir.push(format!("function {}:", name));
-                for param in parameters {
-                    if let ASTNode::VariableDeclaration { name, .. } = param {
-                        ir.push(format!("  param {}", name));
-                    }
-                }
-                generate_node_ir(body, ir);
-                ir.push("end_function".to_string());
-            }
-            ASTNode::Block(statements) => {
-                for stmt in statements {
-                    generate_node_ir(stmt, ir);
-                }
-            }
-            ASTNode::VariableDeclaration { name, initializer, .. } => {
-                if let Some(init) = initializer {
-                    generate_node_ir(init, ir);
-                    ir.push(format!("store {}", name));
-                }
-            }
-            ASTNode::BinaryOperation { left, operator, right } => {
-                generate_node_ir(left, ir);
-                generate_node_ir(right, ir);
-                ir.push(format!("{} {}", operator, operator));
-            }
-            ASTNode::UnaryOperation { operator, operand } => {
-                generate_node_ir(operand, ir);
-                ir.push(format!("{}", operator));
-            }
-            ASTNode::Literal(value) => {
-                ir.push(format!("push {}", value));
-            }
-            ASTNode::Identifier(name) => {
-                ir.push(format!("load {}", name));
+// Trace timestamps are relative to the first use, which main makes at startup
+fn process_start() -> Instant {
+    static START: OnceLock<Instant> = OnceLock::new();
+    *START.get_or_init(Instant::now)
+}
+
+// Small per-thread number for the trace's tid field
+fn trace_thread_id() -> u64 {
+    static NEXT: AtomicUsize = AtomicUsize::new(1);
+    thread_local! {
+        static ID: Cell<u64> = const { Cell::new(0) };
+    }
+    ID.with(|id| {
+        if id.get() == 0 {
+            id.set(NEXT.fetch_add(1, Ordering::Relaxed) as u64);
+        }
+        id.get()
+    })
+}
+
+// One compiler stage as measured by Profiler::stage. `peak` is the most memory the
+// stage had live at once on top of what was live when it started.
+#[derive(Debug, Clone, Copy)]
+struct StageStats {
+    name: &'static str,
+    start: Duration,
+    elapsed: Duration,
+    allocations: u64,
+    allocated: u64,
+    peak: u64,
+    thread: u64,
+}
+
+#[derive(Default)]
+struct Profiler {
+    stages: Vec<StageStats>,
+}
+
+impl Profiler {
+    // Run one stage and record its wall time and the calling thread's allocations
+    fn stage<T>(&mut self, name: &'static str, run: impl FnOnce() -> T) -> T {
+        let before = THREAD_ALLOCS.with(|counters| {
+            let mut c = counters.get();
+            c.peak = c.live;
+            counters.set(c);
+            c
+        });
+        let start = Instant::now();
+        let result = run();
+        let elapsed = start.elapsed();
+        let after = THREAD_ALLOCS.with(Cell::get);
+        self.stages.push(StageStats {
+            name,
+            start: start.duration_since(process_start()),
+            elapsed,
+            allocations: after.allocations - before.allocations,
+            allocated: after.allocated - before.allocated,
+            peak: (after.peak - before.live).max(0) as u64,
+            thread: trace_thread_id(),
+        });
+        result
+    }
+}
+
+// Sum stage statistics by name, in first-seen order; peaks take the maximum
+fn total_stage_stats<'a>(stages: impl IntoIterator<Item = &'a StageStats>) -> Vec<StageStats> {
+    let mut totals: Vec<StageStats> = Vec::new();
+    for stage in stages {
+        match totals.iter_mut().find(|t| t.name == stage.name) {
+            Some(total) => {
+                total.elapsed += stage.elapsed;
+                total.allocations += stage.allocations;
+                total.allocated += stage.allocated;
+                total.peak = total.peak.max(stage.peak);
             }
-            _ => {}
+            None => totals.push(*stage),
         }
     }
+    totals
+}
 
-    generate_node_ir(ast, &mut ir);
-    ir
+fn print_stage_stats(stages: &[StageStats]) {
+    eprintln!("Stage statistics:");
+    eprintln!("  {:<14} {:>10} {:>10} {:>12} {:>12}", "stage", "time", "allocs", "allocated", "peak");
+    for stage in stages {
+        eprintln!(
+            "  {:<14} {:>7.3} ms {:>10} {:>9} KiB {:>9} KiB",
+            stage.name,
+            stage.elapsed.as_secs_f64() * 1000.0,
+            stage.allocations,
+            stage.allocated / 1024,
+            stage.peak / 1024
+        );
+    }
+    eprintln!("  process peak: {} KiB", PROCESS_PEAK.load(Ordering::Relaxed) / 1024);
 }
 
-// Helper function to generate target code (e.g., x86 assembly)
-fn generate_target_code(ir: &[String]) -> Vec<String> {
-    let mut asm = Vec::new();
-    
-    for instruction in ir {
-        let parts: Vec<&str> = instruction.split_whitespace().collect();
-        match parts[0] {
-            "function" => {
-                asm.push(format!("{}:", parts[1].trim_end_matches(':')));
-                asm.push("    push rbp".to_string());
-                asm.push("    mov rbp, rsp".to_string());
-            }
-            "end_function" => {
-                asm.push("    mov rsp, rbp".to_string());
-                asm.push("    pop rbp".to_string());
-                asm.push("    ret".to_string());
-            }
-            "param" => {
-                // Handle parameter passing
-            }
-            "push" => {
-                asm.push(format!("    push {}", parts[1]));
-            }
-            "load" => {
-                asm.push(format!("    mov rax, [{}]", parts[1]));
-                asm.push("    push rax".to_string());
-            }
-            "store" => {
-                asm.push("    pop rax".to_string());
-                asm.push(format!("    mov [{}], rax", parts[1]));
-            }
-            "+" | "-" | "*" | "/" => {
-                asm.push("    pop rbx".to_string());
-                asm.push("    pop rax".to_string());
-                match parts[0] {
-                    "+" => asm.push("    add rax, rbx".to_string()),
-                    "-" => asm.push("    sub rax, rbx".to_string()),
-                    "*" => asm.push("    imul rax, rbx".to_string()),
-                    "/" => {
-                        asm.push("    xor rdx, rdx".to_string());
-                        asm.push("    idiv rbx".to_string());
-                    }
-                    _ => {}
-                }
-                asm.push("    push rax".to_string());
-            }
-            _ => {
-                // Handle other instructions
-            }
+// Minimal JSON string escaping for the trace file
+fn json_string(text: &str) -> String {
+    let mut out = String::with_capacity(text.len() + 2);
+    out.push('"');
+    for c in text.chars() {
+        match c {
+            '"' => out.push_str("\\\""),
+            '\\' => out.push_str("\\\\"),
+            c if (c as u32) < 0x20 => out.push_str(&format!("\\u{:04x}", c as u32)),
+            c => out.push(c),
         }
     }
+    out.push('"');
+    out
+}
 
-    asm
-}
\ No newline at end of file
+// Write stages as complete ("X") events in the Chrome trace event format, loadable in
+// chrome://tracing or Perfetto. Each entry pairs a file name with its stages and their
+// optimizer passes; passes ran back to back inside the "optimize" stage.
+fn write_chrome_trace(path: &str, files: &[(&str, &[StageStats], &[PassTiming])]) -> io::Result<()> {
+    fn event(out: &mut Vec<String>, name: &str, start: Duration, elapsed: Duration, thread: u64, args: String) {
+        out.push(format!(
+            "{{\"name\":{},\"cat\":\"dpp\",\"ph\":\"X\",\"ts\":{:.3},\"dur\":{:.3},\"pid\":1,\"tid\":{},\"args\":{{{}}}}}",
+            json_string(name),
+            start.as_secs_f64() * 1e6,
+            elapsed.as_secs_f64() * 1e6,
+            thread,
+            args
+        ));
+    }
+
+    let mut events = Vec::new();
+    for &(file, stages, passes) in files {
+        for stage in stages {
+            let args = format!(
+                "\"file\":{},\"allocations\":{},\"allocated\":{},\"peak\":{}",
+                json_string(file),
+                stage.allocations,
+                stage.allocated,
+                stage.peak
+            );
+            event(&mut events, stage.name, stage.start, stage.elapsed, stage.thread, args);
+            if stage.name == "optimize" {
+                let mut start = stage.start;
+                for pass in passes {
+                    let args = format!("\"file\":{},\"changes\":{}", json_string(file), pass.changes);
+                    event(&mut events, pass.name, start, pass.elapsed, stage.thread, args);
+                    start += pass.elapsed;
+                }
+            }
+        }
+    }
+    std::fs::write(path, format!("{{\"traceEvents\":[\n{}\n]}}\n", events.join(",\n")))
+}
+
+// Per-file result of the front end and IR generation
+struct CompiledFile {
+    tokens: usize,
+    symbols: usize,
+    ir: Ir,
+    passes: Vec<PassTiming>,
+    stages: Vec<StageStats>,
+    // Token stream, kept only when the result goes into the cache
+    token_stream: Vec<Token>,
+    // Top-level declarations with their types or signatures
+    exports: Vec<(Symbol, Symbol)>,
+}
+
+// Lex, parse, build the symbol table, check, optimize and lower one file
+fn compile_file(file_path: &str, options: &Options) -> Result<CompiledFile, Vec<Diagnostic>> {
+    let mut profiler = Profiler::default();
+    let source = profiler
+        .stage("read", || SourceBuffer::open(file_path, options.use_mmap))
+        .map_err(|e| vec![Diagnostic::new(format!("cannot read: {}", e))])?;
+    compile_source(source.as_bytes(), options, false, profiler)
+}
+
+fn compile_source(
+    source: &[u8],
+    options: &Options,
+    keep_tokens: bool,
+    mut profiler: Profiler,
+) -> Result<CompiledFile, Vec<Diagnostic>> {
+    let (tokens, loaded_ast) = if TokenFile::is_token_file(source) {
+        profiler.stage("load", || read_token_file(source)).map_err(|e| vec![Diagnostic::new(e)])?
+    } else {
+        let tokens = profiler
+            .stage("tokenize", || tokenize_parallel(source, options.lex_jobs))
+            .map_err(|e| vec![Diagnostic { message: format!("lexer error: {}", e.message), ..e }])?;
+        (tokens, None)
+    };
+    let token_count = tokens.len();
+    let token_stream = if keep_tokens { tokens.clone() } else { Vec::new() };
+    let mut ast = match loaded_ast {
+        Some(ast) => ast,
+        None => profiler.stage("parse", || Parser::new(tokens).with_max_errors(options.max_errors).parse())?,
+    };
+    let symbol_table = profiler.stage("symbol-table", || generate_symbol_table(&ast));
+    profiler
+        .stage("semantic", || semantic_analysis(&ast, &symbol_table))
+        .map_err(|e| vec![Diagnostic::new(format!("semantic error: {}", e))])?;
+
+    // Taken from the declarations themselves: the symbol table is flat, so a local there
+    // overwrites a global of the same name
+    let exports = match *ast.node(ast.root()) {
+        ASTNode::Program(declarations) => {
+            ast.list(declarations).iter().filter_map(|&decl| declaration_signature(&ast, decl)).collect()
+        }
+        _ => Vec::new(),
+    };
+
+    let passes = profiler.stage("optimize", || optimize_ast(&mut ast, options.opt_level));
+    let ir = profiler.stage("ir", || generate_ir(&ast));
+    Ok(CompiledFile {
+        tokens: token_count,
+        symbols: symbol_table.len(),
+        ir,
+        passes,
+        stages: profiler.stages,
+        token_stream,
+        exports,
+    })
+}
+
+// Incremental compilation cache. One entry per source path, valid while its key (a hash
+// of the compiler version, -O level, keyword set and file contents) matches.
+const COMPILER_VERSION: &str = "dpp 0.5.0";
+const CACHE_MAGIC: &[u8; 4] = b"DPPC";
+const CACHE_FORMAT: u32 = 3;
+
+const TOKEN_TYPES: [TokenType; 8] = [
+    TokenType::Identifier,
+    TokenType::Keyword,
+    TokenType::Operator,
+    TokenType::Literal,
+    TokenType::Separator,
+    TokenType::Comment,
+    TokenType::Whitespace,
+    TokenType::Eof,
+];
+
+// Cache key for one source file under the current compiler configuration
+fn cache_key(source: &[u8], opt_level: u8) -> u64 {
+    let mut hasher = FnvHasher::default();
+    hasher.write(COMPILER_VERSION.as_bytes());
+    hasher.write(&CACHE_FORMAT.to_le_bytes());
+    hasher.write(&[opt_level]);
+    for word in keywords().words {
+        hasher.write(word.as_bytes());
+        hasher.write(&[0]);
+    }
+    hasher.write(source);
+    hasher.finish()
+}
+
+fn cache_path(cache_dir: &Path, file_path: &str) -> std::path::PathBuf {
+    let mut hasher = FnvHasher::default();
+    hasher.write(file_path.as_bytes());
+    cache_dir.join(format!("{:016x}.dppc", hasher.finish()))
+}
+
+// Little-endian encoder for cache entries; symbols are written as string table indices
+#[derive(Default)]
+struct CacheWriter {
+    bytes: Vec<u8>,
+    strings: Vec<Symbol>,
+    string_index: HashMap<Symbol, u32, FnvBuildHasher>,
+}
+
+impl CacheWriter {
+    fn u8(&mut self, value: u8) {
+        self.bytes.push(value);
+    }
+
+    fn u32(&mut self, value: u32) {
+        self.bytes.extend_from_slice(&value.to_le_bytes());
+    }
+
+    fn u64(&mut self, value: u64) {
+        self.bytes.extend_from_slice(&value.to_le_bytes());
+    }
+
+    fn symbol(&mut self, symbol: Symbol) {
+        let next = self.strings.len() as u32;
+        let index = *self.string_index.entry(symbol).or_insert(next);
+        if index == next {
+            self.strings.push(symbol);
+        }
+        self.u32(index);
+    }
+
+    // Header and string table, followed by the body encoded so far
+    fn finish(self, key: u64) -> Vec<u8> {
+        let mut out = Vec::with_capacity(self.bytes.len() + 16 * self.strings.len() + 32);
+        out.extend_from_slice(CACHE_MAGIC);
+        out.extend_from_slice(&CACHE_FORMAT.to_le_bytes());
+        out.extend_from_slice(&key.to_le_bytes());
+        out.extend_from_slice(&(self.strings.len() as u32).to_le_bytes());
+        for symbol in &self.strings {
+            let text = symbol.as_str();
+            out.extend_from_slice(&(text.len() as u32).to_le_bytes());
+            out.extend_from_slice(text.as_bytes());
+        }
+        out.extend_from_slice(&self.bytes);
+        out
+    }
+}
+
+// Decoder for cache entries; any malformed input reads as None (a cache miss)
+struct CacheReader<'a> {
+    bytes: &'a [u8],
+    pos: usize,
+    strings: Vec<Symbol>,
+}
+
+impl<'a> CacheReader<'a> {
+    fn take(&mut self, len: usize) -> Option<&'a [u8]> {
+        let bytes = self.bytes.get(self.pos..self.pos.checked_add(len)?)?;
+        self.pos += len;
+        Some(bytes)
+    }
+
+    fn u8(&mut self) -> Option<u8> {
+        Some(self.take(1)?[0])
+    }
+
+    fn u32(&mut self) -> Option<u32> {
+        Some(u32::from_le_bytes(self.take(4)?.try_into().ok()?))
+    }
+
+    fn u64(&mut self) -> Option<u64> {
+        Some(u64::from_le_bytes(self.take(8)?.try_into().ok()?))
+    }
+
+    fn symbol(&mut self) -> Option<Symbol> {
+        let index = self.u32()?;
+        self.strings.get(index as usize).copied()
+    }
+
+    // Bound an untrusted element count by the bytes left, so a corrupt count cannot over-allocate
+    fn count(&mut self, element_size: usize) -> Option<usize> {
+        let count = self.u32()? as usize;
+        (count.checked_mul(element_size)? <= self.bytes.len() - self.pos).then_some(count)
+    }
+
+    // Parse the header and string table; None unless the entry was written by this format
+    fn open(bytes: &'a [u8]) -> Option<(CacheReader<'a>, u64)> {
+        let mut reader = CacheReader { bytes, pos: 0, strings: Vec::new() };
+        if reader.take(4)? != CACHE_MAGIC || reader.u32()? != CACHE_FORMAT {
+            return None;
+        }
+        let key = reader.u64()?;
+        let count = reader.count(4)?;
+        reader.strings.reserve(count);
+        for _ in 0..count {
+            let len = reader.u32()? as usize;
+            let text = std::str::from_utf8(reader.take(len)?).ok()?;
+            reader.strings.push(Symbol::intern(text));
+        }
+        Some((reader, key))
+    }
+}
+
+fn encode_cache_entry(key: u64, compiled: &CompiledFile) -> Vec<u8> {
+    let mut w = CacheWriter::default();
+    w.u64(compiled.symbols as u64);
+    w.u32(compiled.token_stream.len() as u32);
+    for token in &compiled.token_stream {
+        w.u8(token.token_type as u8);
+        w.symbol(token.value);
+        w.u32(token.line as u32);
+        w.u32(token.column as u32);
+        w.u32(token.offset as u32);
+    }
+    w.u32(compiled.ir.insts.len() as u32);
+    for inst in &compiled.ir.insts {
+        w.u8(inst.op as u8);
+        w.symbol(inst.operand);
+    }
+    w.u32(compiled.exports.len() as u32);
+    for &(name, signature) in &compiled.exports {
+        w.symbol(name);
+        w.symbol(signature);
+    }
+    w.finish(key)
+}
+
+fn decode_cache_entry(bytes: &[u8]) -> Option<(u64, CompiledFile)> {
+    let (mut r, key) = CacheReader::open(bytes)?;
+    let symbols = r.u64()? as usize;
+    let count = r.count(17)?;
+    let mut token_stream = Vec::with_capacity(count);
+    for _ in 0..count {
+        token_stream.push(Token {
+            token_type: *TOKEN_TYPES.get(r.u8()? as usize)?,
+            value: r.symbol()?,
+            line: r.u32()? as usize,
+            column: r.u32()? as usize,
+            offset: r.u32()? as usize,
+        });
+    }
+    let count = r.count(5)?;
+    let mut ir = Ir::default();
+    ir.insts.reserve(count);
+    for _ in 0..count {
+        let op = *Opcode::ALL.get(r.u8()? as usize)?;
+        ir.emit_with(op, r.symbol()?);
+    }
+    let count = r.count(8)?;
+    let mut exports = Vec::with_capacity(count);
+    for _ in 0..count {
+        exports.push((r.symbol()?, r.symbol()?));
+    }
+    (r.pos == bytes.len()).then_some(())?;
+    let compiled = CompiledFile {
+        tokens: token_stream.len(),
+        symbols,
+        ir,
+        passes: Vec::new(),
+        stages: Vec::new(),
+        token_stream,
+        exports,
+    };
+    Some((key, compiled))
+}
+
+fn read_cache_entry(path: &Path) -> Option<(u64, CompiledFile)> {
+    decode_cache_entry(&std::fs::read(path).ok()?)
+}
+
+// Write through a temporary file and rename, so a crash never leaves a torn entry
+fn write_cache_entry(path: &Path, key: u64, compiled: &CompiledFile) -> io::Result<()> {
+    let temp = path.with_extension(format!("tmp{}", std::process::id()));
+    std::fs::write(&temp, encode_cache_entry(key, compiled))?;
+    std::fs::rename(&temp, path)
+}
+
+// Binary token stream and AST interchange format, shared with the C front end. The
+// layout is documented in src/token_file.h; the two must change together. A file is a
+// fixed header and a table of 8-byte aligned sections holding flat little-endian arrays
+// (the source text, one array per token field, nodes, child lists and a string table),
+// so TokenFile checks it once and then reads tokens and nodes straight out of the bytes.
+const TOKEN_FILE_MAGIC: &[u8; 4] = b"DPTF";
+const TOKEN_FILE_VERSION: u32 = 1;
+const TOKEN_FILE_NONE: u32 = u32::MAX;
+const TOKEN_FILE_HEADER_BYTES: usize = 208;
+const TOKEN_FILE_NODE_WORDS: usize = 6;
+
+// Sections, in file order
+const TF_SOURCE: usize = 0;
+const TF_TYPES: usize = 1;
+const TF_OFFSETS: usize = 2;
+const TF_LENGTHS: usize = 3;
+const TF_LINES: usize = 4;
+const TF_COLUMNS: usize = 5;
+const TF_NODES: usize = 6;
+const TF_LISTS: usize = 7;
+const TF_STRINGS: usize = 8;
+const TF_STRING_BYTES: usize = 9;
+const TF_SECTIONS: usize = 10;
+
+impl BinaryOp {
+    // Every operator, indexed by its discriminant (the token file operator code)
+    const ALL: [BinaryOp; 11] = [
+        BinaryOp::Assign,
+        BinaryOp::Equal,
+        BinaryOp::NotEqual,
+        BinaryOp::Less,
+        BinaryOp::LessEqual,
+        BinaryOp::Greater,
+        BinaryOp::GreaterEqual,
+        BinaryOp::Add,
+        BinaryOp::Subtract,
+        BinaryOp::Multiply,
+        BinaryOp::Divide,
+    ];
+}
+
+impl UnaryOp {
+    const ALL: [UnaryOp; 2] = [UnaryOp::Not, UnaryOp::Negate];
+}
+
+fn push_words(out: &mut Vec<u8>, words: impl IntoIterator<Item = u32>) {
+    for word in words {
+        out.extend_from_slice(&word.to_le_bytes());
+    }
+}
+
+// Encode `tokens` of `source`, and the AST parsed from them if given
+fn encode_token_file(source: &[u8], tokens: &[Token], ast: Option<&Ast>) -> Result<Vec<u8>, String> {
+    let too_large = |what: &str| format!("{} too large for a token file", what);
+    if source.len() > u32::MAX as usize || tokens.len() > u32::MAX as usize {
+        return Err(too_large("input"));
+    }
+
+    let mut strings: Vec<Symbol> = Vec::new();
+    let mut string_index: HashMap<Symbol, u32, FnvBuildHasher> = HashMap::default();
+    let mut string = |symbol: Symbol| {
+        let next = strings.len() as u32;
+        let index = *string_index.entry(symbol).or_insert(next);
+        if index == next {
+            strings.push(symbol);
+        }
+        index
+    };
+    let mut nodes = Vec::new();
+    let (list_words, root) = match ast {
+        Some(ast) => {
+            if ast.nodes.len() >= TOKEN_FILE_NONE as usize || ast.lists.len() > u32::MAX as usize {
+                return Err(too_large("AST"));
+            }
+            for node in &ast.nodes {
+                let (kind, fields) = match *node {
+                    ASTNode::Program(list) => (0, [list.start, list.len, 0, 0, 0]),
+                    ASTNode::FunctionDeclaration { name, parameters, return_type, body } => {
+                        (1, [string(name), parameters.start, parameters.len, return_type.0, body.0])
+                    }
+                    ASTNode::VariableDeclaration { name, var_type, initializer } => {
+                        (2, [string(name), var_type.0, initializer.map_or(TOKEN_FILE_NONE, |i| i.0), 0, 0])
+                    }
+                    ASTNode::Type(name) => (3, [string(name), 0, 0, 0, 0]),
+                    ASTNode::Block(list) => (4, [list.start, list.len, 0, 0, 0]),
+                    ASTNode::Expression(expr) => (5, [expr.0, 0, 0, 0, 0]),
+                    ASTNode::BinaryOperation { left, operator, right } => (6, [left.0, operator as u32, right.0, 0, 0]),
+                    ASTNode::UnaryOperation { operator, operand } => (7, [operator as u32, operand.0, 0, 0, 0]),
+                    ASTNode::Literal(value) => (8, [string(value), 0, 0, 0, 0]),
+                    ASTNode::Identifier(name) => (9, [string(name), 0, 0, 0, 0]),
+                };
+                push_words(&mut nodes, std::iter::once(kind).chain(fields));
+            }
+            (ast.lists.iter().map(|id| id.0).collect::<Vec<u32>>(), ast.root.map_or(TOKEN_FILE_NONE, |r| r.0))
+        }
+        None => (Vec::new(), TOKEN_FILE_NONE),
+    };
+    let mut string_table = Vec::with_capacity(8 * strings.len());
+    let mut string_bytes = Vec::new();
+    for symbol in &strings {
+        let text = symbol.as_str().as_bytes();
+        push_words(&mut string_table, [string_bytes.len() as u32, text.len() as u32]);
+        string_bytes.extend_from_slice(text);
+    }
+    if string_bytes.len() > u32::MAX as usize {
+        return Err(too_large("string table"));
+    }
+
+    let mut columns = [Vec::new(), Vec::new(), Vec::new(), Vec::new()];
+    for token in tokens {
+        push_words(&mut columns[0], [token.offset as u32]);
+        push_words(&mut columns[1], [token_source_len(source, token) as u32]);
+        push_words(&mut columns[2], [token.line as u32]);
+        push_words(&mut columns[3], [token.column as u32]);
+    }
+    let types: Vec<u8> = tokens.iter().map(|t| t.token_type as u8).collect();
+    let mut lists = Vec::with_capacity(4 * list_words.len());
+    push_words(&mut lists, list_words);
+
+    let mut out = vec![0u8; TOKEN_FILE_HEADER_BYTES];
+    let mut table = Vec::with_capacity(16 * TF_SECTIONS);
+    let sections: [&[u8]; TF_SECTIONS] =
+        [source, &types, &columns[0], &columns[1], &columns[2], &columns[3], &nodes, &lists, &string_table, &string_bytes];
+    for section in sections {
+        table.extend_from_slice(&(out.len() as u64).to_le_bytes());
+        table.extend_from_slice(&(section.len() as u64).to_le_bytes());
+        out.extend_from_slice(section);
+        out.resize((out.len() + 7) & !7, 0);
+    }
+
+    let mut header = Vec::with_capacity(TOKEN_FILE_HEADER_BYTES);
+    header.extend_from_slice(TOKEN_FILE_MAGIC);
+    push_words(&mut header, [TOKEN_FILE_VERSION, TOKEN_FILE_HEADER_BYTES as u32, 0]);
+    header.extend_from_slice(&(source.len() as u64).to_le_bytes());
+    let node_count = ast.map_or(0, |a| a.nodes.len());
+    push_words(
+        &mut header,
+        [tokens.len() as u32, node_count as u32, (lists.len() / 4) as u32, strings.len() as u32, root, 0],
+    );
+    header.extend_from_slice(&table);
+    out[..TOKEN_FILE_HEADER_BYTES].copy_from_slice(&header);
+    Ok(out)
+}
+
+// Bytes of `source` a token spans. Only string literals can hold non-ASCII bytes, whose
+// interned text may differ in length, so their extent is found from the quotes.
+fn token_source_len(source: &[u8], token: &Token) -> usize {
+    let rest = &source[token.offset.min(source.len())..];
+    match token.token_type {
+        TokenType::Eof => 0,
+        TokenType::Literal if rest.first() == Some(&b'"') => rest[1..].iter().position(|&c| c == b'"').map_or(rest.len(), |end| end + 2),
+        _ => token.value.as_str().len().min(rest.len()),
+    }
+}
+
+// A validated token file; tokens and nodes are decoded from the bytes on demand
+struct TokenFile<'a> {
+    bytes: &'a [u8],
+    token_count: usize,
+    node_count: usize,
+    list_count: usize,
+    string_count: usize,
+    root: u32,
+    sections: [std::ops::Range<usize>; TF_SECTIONS],
+}
+
+impl<'a> TokenFile<'a> {
+    fn is_token_file(bytes: &[u8]) -> bool {
+        bytes.starts_with(TOKEN_FILE_MAGIC)
+    }
+
+    // Check the header and that every section has the size its count implies
+    fn open(bytes: &'a [u8]) -> Result<TokenFile<'a>, String> {
+        let le32 = |at: usize| u32::from_le_bytes(bytes[at..at + 4].try_into().unwrap());
+        let le64 = |at: usize| u64::from_le_bytes(bytes[at..at + 8].try_into().unwrap());
+        if bytes.len() < TOKEN_FILE_HEADER_BYTES || !Self::is_token_file(bytes) {
+            return Err("not a token file".to_string());
+        }
+        if le32(4) != TOKEN_FILE_VERSION || le32(8) as usize != TOKEN_FILE_HEADER_BYTES || le32(12) != 0 {
+            return Err(format!("unsupported token file version {}", le32(4)));
+        }
+        let source_length = le64(16);
+        let (tokens, nodes, lists, strings) = (le32(24) as u64, le32(28) as u64, le32(32) as u64, le32(36) as u64);
+        let expected = [
+            Some(source_length),
+            Some(tokens),
+            Some(4 * tokens),
+            Some(4 * tokens),
+            Some(4 * tokens),
+            Some(4 * tokens),
+            Some(4 * TOKEN_FILE_NODE_WORDS as u64 * nodes),
+            Some(4 * lists),
+            Some(8 * strings),
+            None,
+        ];
+        let mut sections: [std::ops::Range<usize>; TF_SECTIONS] = Default::default();
+        for (i, expected) in expected.into_iter().enumerate() {
+            let (offset, size) = (le64(48 + 16 * i), le64(56 + 16 * i));
+            let end = offset.checked_add(size).filter(|&end| end <= bytes.len() as u64);
+            if expected.map_or(false, |e| e != size) || offset % 8 != 0 || end.is_none() {
+                return Err("corrupt token file section table".to_string());
+            }
+            sections[i] = offset as usize..end.unwrap() as usize;
+        }
+        Ok(TokenFile {
+            bytes,
+            token_count: tokens as usize,
+            node_count: nodes as usize,
+            list_count: lists as usize,
+            string_count: strings as usize,
+            root: le32(40),
+            sections,
+        })
+    }
+
+    fn section(&self, section: usize) -> &'a [u8] {
+        &self.bytes[self.sections[section].clone()]
+    }
+
+    fn word(&self, section: usize, index: usize) -> u32 {
+        let at = self.sections[section].start + 4 * index;
+        u32::from_le_bytes(self.bytes[at..at + 4].try_into().unwrap())
+    }
+
+    fn source(&self) -> &'a [u8] {
+        self.section(TF_SOURCE)
+    }
+
+    fn string(&self, index: u32) -> Result<Symbol, String> {
+        let index = index as usize;
+        let text = (index < self.string_count)
+            .then(|| {
+                let (start, len) = (self.word(TF_STRINGS, 2 * index) as usize, self.word(TF_STRINGS, 2 * index + 1) as usize);
+                self.section(TF_STRING_BYTES).get(start..start.checked_add(len)?)
+            })
+            .flatten()
+            .and_then(|bytes| std::str::from_utf8(bytes).ok())
+            .ok_or_else(|| format!("corrupt token file string {}", index))?;
+        Ok(Symbol::intern(text))
+    }
+
+    // The token stream, with token text interned as the lexer does
+    fn tokens(&self) -> Result<Vec<Token>, String> {
+        let source = self.source();
+        let types = self.section(TF_TYPES);
+        let mut tokens = Vec::with_capacity(self.token_count);
+        for i in 0..self.token_count {
+            let token_type = *TOKEN_TYPES.get(types[i] as usize).ok_or_else(|| format!("corrupt token type at token {}", i))?;
+            let (offset, length) = (self.word(TF_OFFSETS, i) as usize, self.word(TF_LENGTHS, i) as usize);
+            let text = source.get(offset..offset + length).ok_or_else(|| format!("token {} lies outside the source", i))?;
+            tokens.push(Token {
+                token_type,
+                value: if token_type == TokenType::Eof { sym::EOF } else { Symbol::intern(&String::from_utf8_lossy(text)) },
+                line: self.word(TF_LINES, i) as usize,
+                column: self.word(TF_COLUMNS, i) as usize,
+                offset,
+            });
+        }
+        Ok(tokens)
+    }
+
+    // The AST, if the file carries one. Children must precede their parents, as the
+    // parser builds them, which also rules out cycles, and have the kinds the parser gives
+    // them, so every later stage sees a tree it could have parsed.
+    fn ast(&self) -> Result<Option<Ast>, String> {
+        fn is_expression(node: &ASTNode) -> bool {
+            matches!(
+                node,
+                ASTNode::BinaryOperation { .. } | ASTNode::UnaryOperation { .. } | ASTNode::Literal(_) | ASTNode::Identifier(_)
+            )
+        }
+        fn is_declaration(node: &ASTNode) -> bool {
+            matches!(node, ASTNode::FunctionDeclaration { .. } | ASTNode::VariableDeclaration { .. })
+        }
+        fn is_statement(node: &ASTNode) -> bool {
+            matches!(node, ASTNode::VariableDeclaration { .. } | ASTNode::Expression(_))
+        }
+        fn is_parameter(node: &ASTNode) -> bool {
+            matches!(node, ASTNode::VariableDeclaration { initializer: None, .. })
+        }
+        fn is_type(node: &ASTNode) -> bool {
+            matches!(node, ASTNode::Type(_))
+        }
+
+
+        if self.root == TOKEN_FILE_NONE {
+            return Ok(None);
+        }
+        let corrupt = |i: usize| format!("corrupt token file node {}", i);
+        let mut ast = Ast::default();
+        ast.lists = (0..self.list_count).map(|i| NodeId(self.word(TF_LISTS, i))).collect();
+        ast.nodes.reserve(self.node_count);
+        for i in 0..self.node_count {
+            let word = |k: usize| self.word(TF_NODES, TOKEN_FILE_NODE_WORDS * i + k);
+            let child = |k: usize| Some(NodeId(word(k))).filter(|id| (id.0 as usize) < i);
+            let list = |k: usize| {
+                let list = NodeList { start: word(k), len: word(k + 1) };
+                let end = (list.start as usize).checked_add(list.len as usize).filter(|&end| end <= ast.lists.len())?;
+                ast.lists[list.start as usize..end].iter().all(|id| (id.0 as usize) < i).then_some(list)
+            };
+            let node = match word(0) {
+                0 => ASTNode::Program(list(1).ok_or_else(|| corrupt(i))?),
+                1 => ASTNode::FunctionDeclaration {
+                    name: self.string(word(1))?,
+                    parameters: list(2).ok_or_else(|| corrupt(i))?,
+                    return_type: child(4).ok_or_else(|| corrupt(i))?,
+                    body: child(5).ok_or_else(|| corrupt(i))?,
+                },
+                2 => ASTNode::VariableDeclaration {
+                    name: self.string(word(1))?,
+                    var_type: child(2).ok_or_else(|| corrupt(i))?,
+                    initializer: match word(3) {
+                        TOKEN_FILE_NONE => None,
+                        _ => Some(child(3).ok_or_else(|| corrupt(i))?),
+                    },
+                },
+                3 => ASTNode::Type(self.string(word(1))?),
+                4 => ASTNode::Block(list(1).ok_or_else(|| corrupt(i))?),
+                5 => ASTNode::Expression(child(1).ok_or_else(|| corrupt(i))?),
+                6 => ASTNode::BinaryOperation {
+                    left: child(1).ok_or_else(|| corrupt(i))?,
+                    operator: *BinaryOp::ALL.get(word(2) as usize).ok_or_else(|| corrupt(i))?,
+                    right: child(3).ok_or_else(|| corrupt(i))?,
+                },
+                7 => ASTNode::UnaryOperation {
+                    operator: *UnaryOp::ALL.get(word(1) as usize).ok_or_else(|| corrupt(i))?,
+                    operand: child(2).ok_or_else(|| corrupt(i))?,
+                },
+                8 => ASTNode::Literal(self.string(word(1))?),
+                9 => ASTNode::Identifier(self.string(word(1))?),
+                _ => return Err(corrupt(i)),
+            };
+            let kind = |id: NodeId| ast.node(id);
+            let all = |list: NodeList, f: fn(&ASTNode) -> bool| ast.list(list).iter().all(|&id| f(kind(id)));
+            let valid = match node {
+                ASTNode::Program(list) => all(list, is_declaration),
+                ASTNode::FunctionDeclaration { parameters, return_type, body, .. } => {
+                    all(parameters, is_parameter) && is_type(kind(return_type)) && matches!(kind(body), ASTNode::Block(_))
+                }
+                ASTNode::VariableDeclaration { var_type, initializer, .. } => {
+                    is_type(kind(var_type)) && initializer.map_or(true, |init| is_expression(kind(init)))
+                }
+                ASTNode::Block(list) => all(list, is_statement),
+                ASTNode::Expression(expr) => is_expression(kind(expr)),
+                ASTNode::BinaryOperation { left, operator, right } => {
+                    is_expression(kind(left))
+                        && is_expression(kind(right))
+                        && (operator != BinaryOp::Assign || matches!(kind(left), ASTNode::Identifier(_)))
+                }
+                ASTNode::UnaryOperation { operand, .. } => is_expression(kind(operand)),
+                ASTNode::Type(_) | ASTNode::Literal(_) | ASTNode::Identifier(_) => true,
+            };
+            if !valid {
+                return Err(corrupt(i));
+            }
+            ast.nodes.push(node);
+        }
+        if !matches!(ast.nodes.get(self.root as usize), Some(ASTNode::Program(_))) {
+            return Err("corrupt token file root".to_string());
+        }
+        ast.root = Some(NodeId(self.root));
+        Ok(Some(ast))
+    }
+}
+
+// Tokens of a token file, and its AST if it has one
+fn read_token_file(bytes: &[u8]) -> Result<(Vec<Token>, Option<Ast>), String> {
+    let file = TokenFile::open(bytes)?;
+    Ok((file.tokens()?, file.ast()?))
+}
+
+// Differential check of the two lexers. Each input is a token file written by the other
+// one (Lexer --emit-tokens); its source is lexed again here, with --lex-jobs threads, and
+// the streams must agree in every type, text, line, column and offset. One line per
+// file; returns false when any stream differs.
+fn run_check_tokens(options: &Options) -> io::Result<bool> {
+    fn describe(token: Option<&Token>) -> String {
+        match token {
+            Some(t) => format!("{:?} {:?} at {}:{} (offset {})", t.token_type, t.value.as_str(), t.line, t.column, t.offset),
+            None => "the end of the stream".to_string(),
+        }
+    }
+
+    let mut ok = true;
+    for path in &options.inputs {
+        let buffer = SourceBuffer::open(path, options.use_mmap)?;
+        let checked = TokenFile::open(buffer.as_bytes()).and_then(|file| {
+            let expected = file.tokens()?;
+            let lexed = tokenize_parallel(file.source(), options.lex_jobs).map_err(|e| format!("lexer error: {}", e))?;
+            let index = expected.iter().zip(&lexed).position(|(a, b)| a != b);
+            match index.or((expected.len() != lexed.len()).then(|| expected.len().min(lexed.len()))) {
+                Some(i) => Err(format!(
+                    "token {} differs: the file has {}, this lexer has {}",
+                    i,
+                    describe(expected.get(i)),
+                    describe(lexed.get(i))
+                )),
+                None => Ok(expected.len()),
+            }
+        });
+        match checked {
+            Ok(count) => println!("{}: {} tokens match", path, count),
+            Err(e) => {
+                eprintln!("{}", Diagnostic::new(e).render(path));
+                ok = false;
+            }
+        }
+    }
+    Ok(ok)
+}
+
+// How a file was handled in a cached batch build
+enum CacheOutcome {
+    Reused(CompiledFile),
+    // Rebuilt, with the exports recorded by the stale entry (if there was one)
+    Rebuilt(Result<CompiledFile, Vec<Diagnostic>>, Option<Vec<(Symbol, Symbol)>>),
+}
+
+// Compile one file, reusing its cache entry when the key still matches
+fn compile_cached(file_path: &str, options: &Options, cache_dir: &Path) -> CacheOutcome {
+    let entry_path = cache_path(cache_dir, file_path);
+    let previous = read_cache_entry(&entry_path);
+    let mut profiler = Profiler::default();
+    let source = match profiler.stage("read", || SourceBuffer::open(file_path, options.use_mmap)) {
+        Ok(source) => source,
+        Err(e) => {
+            let _ = std::fs::remove_file(&entry_path);
+            let error = vec![Diagnostic::new(format!("cannot read: {}", e))];
+            return CacheOutcome::Rebuilt(Err(error), previous.map(|(_, p)| p.exports));
+        }
+    };
+    let key = cache_key(source.as_bytes(), options.opt_level);
+    match previous {
+        Some((previous_key, compiled)) if previous_key == key => CacheOutcome::Reused(compiled),
+        previous => {
+            let result = compile_source(source.as_bytes(), options, true, profiler);
+            // Positions are stored as u32; larger files are compiled but never cached
+            match &result {
+                Ok(compiled) if source.as_bytes().len() <= u32::MAX as usize => {
+                    let _ = write_cache_entry(&entry_path, key, compiled);
+                }
+                _ => {
+                    let _ = std::fs::remove_file(&entry_path);
+                }
+            }
+            CacheOutcome::Rebuilt(result, previous.map(|(_, p)| p.exports))
+        }
+    }
+}
+
+// Record every name whose exported signature differs between two export lists
+fn changed_exports(old: &[(Symbol, Symbol)], new: &[(Symbol, Symbol)], changed: &mut HashMap<Symbol, (), FnvBuildHasher>) {
+    let old_map: HashMap<Symbol, Symbol, FnvBuildHasher> = old.iter().copied().collect();
+    let new_map: HashMap<Symbol, Symbol, FnvBuildHasher> = new.iter().copied().collect();
+    for (name, signature) in &old_map {
+        if new_map.get(name) != Some(signature) {
+            changed.insert(*name, ());
+        }
+    }
+    for (name, signature) in &new_map {
+        if old_map.get(name) != Some(signature) {
+            changed.insert(*name, ());
+        }
+    }
+}
+
+
+// Per-pass timing report for --time-passes, written to stderr
+fn print_pass_timings(timings: &[PassTiming]) {
+    eprintln!("Optimization pass timings:");
+    for timing in timings {
+        eprintln!(
+            "  {:<14} {:>10.3} ms {:>8} changes",
+            timing.name,
+            timing.elapsed.as_secs_f64() * 1000.0,
+            timing.changes
+        );
+    }
+}
+
+// Cached batch build: reuse entries whose key matches and rebuild the rest. A file cannot
+// refer to another file's declarations, so a rebuild never invalidates other entries;
+// exported declarations whose signature changed are only counted for the summary.
+fn run_cached(
+    files: &[String],
+    jobs: usize,
+    options: &Options,
+    cache_dir: &Path,
+) -> io::Result<Vec<Result<CompiledFile, Vec<Diagnostic>>>> {
+    std::fs::create_dir_all(cache_dir)?;
+    let outcomes = run_parallel(files.len(), jobs, |i| compile_cached(&files[i], options, cache_dir));
+
+    let mut changed: HashMap<Symbol, (), FnvBuildHasher> = HashMap::default();
+    let mut results = Vec::with_capacity(files.len());
+    let mut reused = 0;
+    for outcome in outcomes {
+        match outcome {
+            CacheOutcome::Reused(compiled) => {
+                reused += 1;
+                results.push(Ok(compiled));
+            }
+            CacheOutcome::Rebuilt(result, previous) => {
+                let new = result.as_ref().map_or(&[][..], |c| &c.exports[..]);
+                changed_exports(previous.as_deref().unwrap_or(&[]), new, &mut changed);
+                results.push(result);
+            }
+        }
+    }
+
+    eprintln!(
+        "Cache: {} reused, {} rebuilt ({} exported declarations changed).",
+        reused,
+        files.len() - reused,
+        changed.len()
+    );
+    Ok(results)
+}
+
+// Compile many files in parallel; per-file lines and errors are reported in input order
+fn run_batch(options: &Options) -> io::Result<bool> {
+    let files = expand_inputs(&options.inputs)?;
+    let jobs = options
+        .jobs
+        .unwrap_or_else(|| std::thread::available_parallelism().map_or(1, |n| n.get()));
+
+    let results = match &options.cache_dir {
+        Some(cache_dir) => run_cached(&files, jobs, options, Path::new(cache_dir))?,
+        None => run_parallel(files.len(), jobs, |i| compile_file(&files[i], options)),
+    };
+
+    let mut errors = Vec::new();
+    let mut failed = 0;
+    let mut totals: Vec<PassTiming> = Vec::new();
+    for (file, result) in files.iter().zip(&results) {
+        if let Ok(compiled) = result {
+            for (i, pass) in compiled.passes.iter().enumerate() {
+                match totals.get_mut(i) {
+                    Some(total) => {
+                        total.elapsed += pass.elapsed;
+                        total.changes += pass.changes;
+                    }
+                    None => totals.push(*pass),
+                }
+            }
+        }
+        match result {
+            Ok(compiled) => println!(
+                "{}: {} tokens, {} symbols, {} IR instructions",
+                file,
+                compiled.tokens,
+                compiled.symbols,
+                compiled.ir.len()
+            ),
+            Err(diagnostics) => {
+                failed += 1;
+                errors.extend(diagnostics.iter().map(|d| d.render(file)));
+            }
+        }
+    }
+    io::Write::flush(&mut io::stdout())?;
+    for error in &errors {
+        eprintln!("error: {}", error);
+    }
+    println!(
+        "Compiled {} files with {} threads: {} succeeded, {} failed.",
+        files.len(),
+        jobs.min(files.len().max(1)),
+        files.len() - failed,
+        failed
+    );
+    let compiled: Vec<(&str, &CompiledFile)> = files
+        .iter()
+        .zip(&results)
+        .filter_map(|(file, result)| Some((file.as_str(), result.as_ref().ok()?)))
+        .collect();
+    if options.stats || options.time_passes {
+        // Stage times are summed over files, so with several jobs they exceed wall time
+        print_stage_stats(&total_stage_stats(compiled.iter().flat_map(|(_, c)| &c.stages)));
+    }
+    if options.time_passes {
+        print_pass_timings(&totals);
+    }
+    if let Some(path) = &options.trace {
+        let files: Vec<_> = compiled.iter().map(|&(file, c)| (file, &c.stages[..], &c.passes[..])).collect();
+        write_chrome_trace(path, &files)?;
+    }
+    Ok(failed == 0)
+}
+
+// What a synthetic corpus stresses. Program is a realistic mix; the others skew the
+// bytes towards one kind of lexeme but still parse, so every stage can run on them.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum CorpusShape {
+    Program,
+    Identifiers,
+    Numbers,
+    // Runs of spaces, tabs and newlines, comments and multi-line string literals
+    Whitespace,
+    // Whole functions on single lines of about 64 KiB
+    LongLines,
+}
+
+impl CorpusShape {
+    fn parse(name: &str) -> Option<CorpusShape> {
+        match name {
+            "program" => Some(CorpusShape::Program),
+            "identifiers" => Some(CorpusShape::Identifiers),
+            "numbers" => Some(CorpusShape::Numbers),
+            "whitespace" => Some(CorpusShape::Whitespace),
+            "long-lines" => Some(CorpusShape::LongLines),
+            _ => None,
+        }
+    }
+}
+
+// Synthetic corpus parameters: target size in bytes, number of distinct identifiers,
+// maximum expression nesting depth and shape. The same spec and seed always produce the
+// same text.
+#[derive(Debug, Clone, Copy)]
+struct CorpusSpec {
+    size: usize,
+    idents: usize,
+    depth: usize,
+    seed: u64,
+    shape: CorpusShape,
+}
+
+impl Default for CorpusSpec {
+    fn default() -> Self {
+        CorpusSpec {
+            size: 4 << 20,
+            idents: 1000,
+            depth: 8,
+            seed: 1,
+            shape: CorpusShape::Program,
+        }
+    }
+}
+
+// SplitMix64: small, seedable and identical on every platform
+struct CorpusRng(u64);
+
+impl CorpusRng {
+    fn next(&mut self) -> u64 {
+        self.0 = self.0.wrapping_add(0x9e37_79b9_7f4a_7c15);
+        let mut z = self.0;
+        z = (z ^ (z >> 30)).wrapping_mul(0xbf58_476d_1ce4_e5b9);
+        z = (z ^ (z >> 27)).wrapping_mul(0x94d0_49bb_1331_11eb);
+        z ^ (z >> 31)
+    }
+
+    fn below(&mut self, n: usize) -> usize {
+        (self.next() % n as u64) as usize
+    }
+}
+
+// Identifier `i` of the corpus: a word stem plus the index in base 26, so names are
+// unique, never keywords, and vary in length the way real code does
+fn corpus_identifier(i: usize) -> String {
+    const STEMS: [&str; 8] = ["count", "total", "idx", "value", "tmp", "acc", "node", "len"];
+    let mut name = String::from(STEMS[i % STEMS.len()]);
+    name.push('_');
+    let mut n = i / STEMS.len();
+    loop {
+        name.push((b'a' + (n % 26) as u8) as char);
+        n /= 26;
+        if n == 0 {
+            break;
+        }
+    }
+    name
+}
+
+// Generate a valid D++ program of at least spec.size bytes: a prelude declaring every
+// identifier, then functions of declarations, assignments and expression statements.
+// Expressions grow one operand at a time, so their size is linear in the nesting depth.
+fn generate_corpus(spec: &CorpusSpec) -> String {
+    const OPERATORS: [&str; 10] = ["+", "-", "*", "/", "==", "!=", "<", "<=", ">", ">="];
+
+    fn leaf(rng: &mut CorpusRng, names: &[String], out: &mut String) {
+        if rng.below(10) < 7 {
+            out.push_str(&names[rng.below(names.len())]);
+        } else {
+            out.push_str(&(1 + rng.below(100_000)).to_string());
+        }
+    }
+
+    // A number literal, integral or with a fraction
+    fn number(rng: &mut CorpusRng, out: &mut String) {
+        out.push_str(&rng.below(1_000_000_000).to_string());
+        if rng.below(3) == 0 {
+            out.push_str(&format!(".{}", rng.below(100_000)));
+        }
+    }
+
+    // A run of blanks with the occasional line break
+    fn blanks(rng: &mut CorpusRng, out: &mut String) {
+        for _ in 0..1 + rng.below(16) {
+            out.push(match rng.below(8) {
+                0 => '\n',
+                1 | 2 => '\t',
+                _ => ' ',
+            });
+        }
+    }
+
+    fn expression(rng: &mut CorpusRng, names: &[String], depth: usize, out: &mut String) {
+        if depth == 0 {
+            return leaf(rng, names, out);
+        }
+        let operator = OPERATORS[rng.below(OPERATORS.len())];
+        match rng.below(4) {
+            0 => {
+                out.push('(');
+                expression(rng, names, depth - 1, out);
+                out.push_str(") ");
+                out.push_str(operator);
+                out.push(' ');
+                leaf(rng, names, out);
+            }
+            1 => {
+                leaf(rng, names, out);
+                out.push(' ');
+                out.push_str(operator);
+                out.push_str(" (");
+                expression(rng, names, depth - 1, out);
+                out.push(')');
+            }
+            2 => {
+                out.push_str(if rng.below(2) == 0 { "-(" } else { "!(" });
+                expression(rng, names, depth - 1, out);
+                out.push(')');
+            }
+            _ => {
+                expression(rng, names, depth - 1, out);
+                out.push(' ');
+                out.push_str(operator);
+                out.push(' ');
+                leaf(rng, names, out);
+            }
+        }
+    }
+
+    let mut rng = CorpusRng(spec.seed);
+    let names: Vec<String> = (0..spec.idents.max(1)).map(corpus_identifier).collect();
+    let depth = spec.depth.clamp(1, MAX_EXPRESSION_DEPTH / 2);
+    let mut out = String::with_capacity(spec.size + 4096);
+
+    out.push_str("// Generated D++ benchmark corpus\n");
+    for name in &names {
+        out.push_str(&format!("let {}: int = {};\n", name, rng.below(1000)));
+    }
+    let mut function = 0;
+    while out.len() < spec.size {
+        // Program draws its names itself, so its corpus is the same as before shapes existed
+        let target = if spec.shape == CorpusShape::Program { "" } else { &names[rng.below(names.len())] };
+        match spec.shape {
+            CorpusShape::Program => {
+                let a = &names[rng.below(names.len())];
+                let b = &names[rng.below(names.len())];
+                out.push_str(&format!("\nfn step_{}({}: int, {}: int) -> int {{\n", function, a, b));
+                for _ in 0..1 + rng.below(8) {
+                    out.push_str("    ");
+                    let target = &names[rng.below(names.len())];
+                    match rng.below(3) {
+                        0 => out.push_str(&format!("let {}: int = ", target)),
+                        1 => out.push_str(&format!("{} = ", target)),
+                        _ => {}
+                    }
+                    let nesting = 1 + rng.below(depth);
+                    expression(&mut rng, &names, nesting, &mut out);
+                    out.push_str(";\n");
+                }
+                out.push_str("}\n");
+                function += 1;
+            }
+            CorpusShape::Identifiers => {
+                out.push_str(&format!("let {}: int = {}", target, names[rng.below(names.len())]));
+                for _ in 0..8 + rng.below(24) {
+                    out.push_str(OPERATORS[rng.below(4)]);
+                    out.push_str(&names[rng.below(names.len())]);
+                }
+                out.push_str(";\n");
+            }
+            CorpusShape::Numbers => {
+                out.push_str(&format!("let {}: int = ", target));
+                number(&mut rng, &mut out);
+                for _ in 0..8 + rng.below(24) {
+                    out.push_str(OPERATORS[rng.below(4)]);
+                    number(&mut rng, &mut out);
+                }
+                out.push_str(";\n");
+            }
+            CorpusShape::Whitespace => {
+                if rng.below(4) == 0 {
+                    out.push_str("\n\t// a \"quoted\" remark // with slashes\n");
+                }
+                for (i, part) in ["let", target, ":", "int", "="].iter().enumerate() {
+                    if i > 0 {
+                        blanks(&mut rng, &mut out);
+                    }
+                    out.push_str(part);
+                }
+                blanks(&mut rng, &mut out);
+                if rng.below(8) == 0 {
+                    out.push_str("\"text with\n  a line break // and no comment\"");
+                } else {
+                    leaf(&mut rng, &names, &mut out);
+                }
+                blanks(&mut rng, &mut out);
+                out.push_str(";\n\n");
+            }
+            CorpusShape::LongLines => {
+                let line_end = out.len() + (64 << 10);
+                out.push_str(&format!("fn line_{}({}: int) -> int {{", function, target));
+                while out.len() < line_end {
+                    out.push_str(&format!(" let {}: int = ", names[rng.below(names.len())]));
+                    let nesting = 1 + rng.below(depth);
+                    expression(&mut rng, &names, nesting, &mut out);
+                    out.push(';');
+                }
+                out.push_str(" }\n");
+                function += 1;
+            }
+        }
+    }
+    out
+}
+
+// Parse a byte count with an optional K, M or G suffix (powers of 1024)
+fn parse_size(text: &str) -> Option<usize> {
+    let (digits, shift) = match text.as_bytes().last()? {
+        b'k' | b'K' => (&text[..text.len() - 1], 10),
+        b'm' | b'M' => (&text[..text.len() - 1], 20),
+        b'g' | b'G' => (&text[..text.len() - 1], 30),
+        _ => (text, 0),
+    };
+    digits.parse::<usize>().ok()?.checked_mul(1 << shift)
+}
+
+// Best and mean wall time of one benchmark stage over `iterations` runs
+struct BenchResult {
+    stage: &'static str,
+    best: Duration,
+    mean: Duration,
+}
+
+fn bench_stage<S, F>(stage: &'static str, iterations: usize, mut setup: impl FnMut() -> S, mut run: F) -> BenchResult
+where
+    F: FnMut(S),
+{
+    let mut best = Duration::MAX;
+    let mut total = Duration::ZERO;
+    for _ in 0..iterations {
+        // Inputs the stage consumes are built outside the timed region
+        let input = setup();
+        let start = Instant::now();
+        run(input);
+        let elapsed = start.elapsed();
+        best = best.min(elapsed);
+        total += elapsed;
+    }
+    BenchResult {
+        stage,
+        best,
+        mean: total / iterations as u32,
+    }
+}
+
+// Benchmark every stage on one corpus, one JSON object per line on stdout. This record
+// layout is shared with `Lexer --bench` so both lexers land in the same results file.
+// Rates are normalized to the corpus (bytes, lexed tokens, parsed AST nodes), so later
+// stages stay comparable across releases even when their own output changes.
+fn run_bench(options: &Options) -> io::Result<bool> {
+    let generated;
+    let source_buffer;
+    let source: &[u8] = match options.inputs.first() {
+        Some(path) => {
+            source_buffer = SourceBuffer::open(path, options.use_mmap)?;
+            source_buffer.as_bytes()
+        }
+        None => {
+            generated = generate_corpus(&options.corpus);
+            generated.as_bytes()
+        }
+    };
+    let iterations = options.iterations.max(1);
+
+    let tokens = match Lexer::new(source).tokenize() {
+        Ok(tokens) => tokens,
+        Err(e) => {
+            eprintln!("error: benchmark corpus does not lex: {}", e);
+            return Ok(false);
+        }
+    };
+    let mut ast = match Parser::new(tokens.clone()).with_max_errors(options.max_errors).parse() {
+        Ok(ast) => ast,
+        Err(diagnostics) => {
+            for diagnostic in &diagnostics {
+                eprintln!("error: {}", diagnostic.render("corpus"));
+            }
+            return Ok(false);
+        }
+    };
+    let nodes = ast.nodes.len();
+    optimize_ast(&mut ast, options.opt_level);
+    let ir = generate_ir(&ast);
+
+    let mut results = vec![
+        bench_stage("rust-lexer", iterations, || (), |()| {
+            std::hint::black_box(Lexer::new(source).tokenize().ok());
+        }),
+        bench_stage("parser", iterations, || tokens.clone(), |tokens| {
+            std::hint::black_box(Parser::new(tokens).with_max_errors(options.max_errors).parse().ok());
+        }),
+        bench_stage("symbol-table", iterations, || (), |()| {
+            std::hint::black_box(generate_symbol_table(&ast));
+        }),
+        bench_stage("ir", iterations, || (), |()| {
+            std::hint::black_box(generate_ir(&ast));
+        }),
+        bench_stage("codegen", iterations, || (), |()| {
+            std::hint::black_box(emit_target_code(&ir, options.opt_level));
+        }),
+    ];
+    if options.lex_jobs > 1 {
+        if tokenize_parallel(source, options.lex_jobs).ok().as_ref() != Some(&tokens) {
+            eprintln!("error: parallel lexing with {} threads differs from serial lexing", options.lex_jobs);
+            return Ok(false);
+        }
+        results.insert(1, bench_stage("rust-lexer-parallel", iterations, || (), |()| {
+            std::hint::black_box(tokenize_parallel(source, options.lex_jobs).ok());
+        }));
+    }
+
+    for result in &results {
+        let seconds = result.best.as_secs_f64().max(1e-9);
+        let stage_nodes = if result.stage.starts_with("rust-lexer") { 0 } else { nodes };
+        println!(
+            "{{\"stage\":\"{}\",\"bytes\":{},\"tokens\":{},\"nodes\":{},\"iterations\":{},\"best_s\":{:.6},\"mean_s\":{:.6},\"mb_per_s\":{:.2},\"tokens_per_s\":{:.0},\"nodes_per_s\":{:.0}}}",
+            result.stage,
+            source.len(),
+            tokens.len(),
+            stage_nodes,
+            iterations,
+            result.best.as_secs_f64(),
+            result.mean.as_secs_f64(),
+            source.len() as f64 / 1e6 / seconds,
+            tokens.len() as f64 / seconds,
+            stage_nodes as f64 / seconds
+        );
+    }
+    Ok(true)
+}
+
+fn main() -> io::Result<()> {
+    process_start();
+    let args: Vec<String> = std::env::args().collect();
+    let options = match Options::parse(&args) {
+        Ok(o) => o,
+        Err(e) => {
+            eprintln!("{}", e);
+            std::process::exit(2);
+        }
+    };
+
+    // Optional dialect keyword file, installed once before any lexing
+    if let Some(path) = &options.keywords {
+        install_keywords(path)?;
+    }
+
+    if let Some(path) = &options.gen_corpus {
+        let corpus = generate_corpus(&options.corpus);
+        if path == "-" {
+            io::Write::write_all(&mut io::stdout(), corpus.as_bytes())?;
+        } else {
+            std::fs::write(path, corpus)?;
+        }
+        return Ok(());
+    }
+    if options.bench {
+        let ok = run_bench(&options)?;
+        std::process::exit(if ok { 0 } else { 1 });
+    }
+    if options.check_tokens {
+        let ok = run_check_tokens(&options)?;
+        std::process::exit(if ok { 0 } else { 1 });
+    }
+
+    if options.is_batch() {
+        let ok = run_batch(&options)?;
+        std::process::exit(if ok { 0 } else { 1 });
+    }
+
+    println!("D++ C Parser Initialization");
+    println!("---------------------------");
+
+    // Input file: first positional argument ("-" for stdin), default input.dpp.
+    // Regular files are memory-mapped and lexed in place; --no-mmap reads them instead.
+    let file_path = options.inputs.first().map_or("input.dpp", |s| s.as_str());
+    let mut profiler = Profiler::default();
+    let source = profiler.stage("read", || SourceBuffer::open(file_path, options.use_mmap))?;
+
+    // A token file (from Lexer --emit-tokens or --emit-tokens here) replaces lexing, and
+    // parsing too when it carries an AST
+    let token_file = if TokenFile::is_token_file(source.as_bytes()) {
+        match TokenFile::open(source.as_bytes()) {
+            Ok(file) => Some(file),
+            Err(e) => {
+                eprintln!("{}", Diagnostic::new(e).render(file_path));
+                return Ok(());
+            }
+        }
+    } else {
+        None
+    };
+    let text = token_file.as_ref().map_or(source.as_bytes(), |file| file.source());
+    let (tokens, loaded_ast) = match &token_file {
+        Some(file) => match profiler.stage("load", || Ok::<_, String>((file.tokens()?, file.ast()?))) {
+            Ok(loaded) => loaded,
+            Err(e) => {
+                eprintln!("{}", Diagnostic::new(e).render(file_path));
+                return Ok(());
+            }
+        },
+        None => {
+            // Lex, on --lex-jobs threads when the input is large enough to split
+            match profiler.stage("tokenize", || tokenize_parallel(text, options.lex_jobs)) {
+                Ok(t) => (t, None),
+                Err(e) => {
+                    eprintln!("Lexer error: {}:{}: {}", e.line, e.column, e.message);
+                    return Ok(());
+                }
+            }
+        }
+    };
+
+    println!("Tokenization complete. Found {} tokens.", tokens.len());
+
+    // --edit: apply one text edit and patch the stream the way an editor would, re-lexing
+    // only around the edit. A loaded AST describes the old text, so it is parsed again.
+    let mut tokens = tokens;
+    let mut loaded_ast = loaded_ast;
+    let edited;
+    let text = match &options.edit {
+        Some((start, end, replacement)) => {
+            if *end > text.len() {
+                eprintln!("{}", Diagnostic::new(format!("--edit range ends past the input ({} bytes)", text.len())).render(file_path));
+                return Ok(());
+            }
+            edited = [&text[..*start], replacement.as_bytes(), &text[*end..]].concat();
+            let edit = TextEdit { start: *start, old_end: *end, new_end: start + replacement.len() };
+            match profiler.stage("relex", || Lexer::relex(&edited, &mut tokens, edit)) {
+                Ok(fresh) => println!("Re-lexed {} of {} tokens after the edit.", fresh.len(), tokens.len()),
+                Err(e) => {
+                    eprintln!("Lexer error: {}", e);
+                    return Ok(());
+                }
+            }
+            loaded_ast = None;
+            &edited[..]
+        }
+        None => text,
+    };
+    let kept_tokens = if options.emit_tokens.is_some() { tokens.clone() } else { Vec::new() };
+
+    // Initialize parser
+    let mut ast = match loaded_ast {
+        Some(ast) => ast,
+        None => {
+            let parser = Parser::new(tokens).with_max_errors(options.max_errors);
+            match profiler.stage("parse", || parser.parse()) {
+                Ok(a) => a,
+                Err(diagnostics) => {
+                    for diagnostic in &diagnostics {
+                        eprintln!("{}", diagnostic.render(file_path));
+                    }
+                    return Ok(());
+                }
+            }
+        }
+    };
+
+    println!("Parsing complete. AST generated.");
+
+    if let Some(path) = &options.emit_tokens {
+        let encoded = profiler.stage("emit-tokens", || encode_token_file(text, &kept_tokens, Some(&ast)));
+        std::fs::write(path, encoded.map_err(|e| io::Error::new(io::ErrorKind::InvalidInput, e))?)?;
+    }
+
+    // The dump is as large as the input several times over; print it only on request
+    if options.dump_ast {
+        println!("Abstract Syntax Tree:");
+        print!("{}", ast.dump());
+    }
+
+    let symbol_table = profiler.stage("symbol-table", || generate_symbol_table(&ast));
+    if let Err(e) = profiler.stage("semantic", || semantic_analysis(&ast, &symbol_table)) {
+        eprintln!("{}", Diagnostic::new(format!("semantic error: {}", e)).render(file_path));
+        return Ok(());
+    }
+
+    let passes = profiler.stage("optimize", || optimize_ast(&mut ast, options.opt_level));
+
+    // Code generation also runs for --stats and --trace, so they cover every stage
+    let profiling = options.stats || options.time_passes || options.trace.is_some();
+    if options.dump_ir || options.emit_asm || profiling {
+        let ir = profiler.stage("ir", || generate_ir(&ast));
+        if options.dump_ir {
+            println!("Intermediate Representation ({} instructions):", ir.len());
+            print!("{}", ir.dump());
+        }
+        if options.emit_asm || profiling {
+            let code = profiler.stage("codegen", || emit_target_code(&ir, options.opt_level));
+            if options.emit_asm {
+                println!("Assembly:");
+                print!("{}", code);
+            }
+        }
+    }
+
+    if options.stats || options.time_passes {
+        print_stage_stats(&profiler.stages);
+    }
+    if options.time_passes {
+        print_pass_timings(&passes);
+    }
+    if let Some(path) = &options.trace {
+        write_chrome_trace(path, &[(file_path, &profiler.stages, &passes)])?;
+    }
+
+    println!("D++ C Parser initialization complete.");
+    Ok(())
+}
+
+// Helper function to get a declaration's name with its type (variables) or signature (functions)
+fn declaration_signature(ast: &Ast, id: NodeId) -> Option<(Symbol, Symbol)> {
+    fn type_name(ast: &Ast, id: NodeId) -> Option<Symbol> {
+        match *ast.node(id) {
+            ASTNode::Type(name) => Some(name),
+            _ => None,
+        }
+    }
+
+    match *ast.node(id) {
+        ASTNode::VariableDeclaration { name, var_type, .. } => Some((name, type_name(ast, var_type)?)),
+        ASTNode::FunctionDeclaration { name, parameters, return_type, .. } => {
+            let mut param_types = Vec::new();
+            for &param in ast.list(parameters) {
+                if let ASTNode::VariableDeclaration { var_type, .. } = *ast.node(param) {
+                    if let Some(type_name) = type_name(ast, var_type) {
+                        param_types.push(type_name.as_str());
+                    }
+                }
+            }
+            let ret_type = type_name(ast, return_type).unwrap_or(sym::VOID);
+            let signature = format!("fn({}) -> {}", param_types.join(", "), ret_type);
+            Some((name, Symbol::intern(&signature)))
+        }
+        _ => None,
+    }
+}
+
+// Helper function to generate symbol table
+fn generate_symbol_table(ast: &Ast) -> SymbolTable {
+    let mut symbol_table = SymbolTable::default();
+
+    fn traverse_ast(ast: &Ast, id: NodeId, table: &mut SymbolTable) {
+        match *ast.node(id) {
+            ASTNode::VariableDeclaration { .. } => {
+                if let Some((name, type_name)) = declaration_signature(ast, id) {
+                    table.insert(name, type_name);
+                }
+            }
+            ASTNode::FunctionDeclaration { parameters, body, .. } => {
+                if let Some((name, signature)) = declaration_signature(ast, id) {
+                    table.insert(name, signature);
+                }
+                // Parameters and locals share the flat table with globals
+                for &param in ast.list(parameters) {
+                    traverse_ast(ast, param, table);
+                }
+                traverse_ast(ast, body, table);
+            }
+            ASTNode::Program(nodes) | ASTNode::Block(nodes) => {
+                for &node in ast.list(nodes) {
+                    traverse_ast(ast, node, table);
+                }
+            }
+            _ => {}
+        }
+    }
+
+    traverse_ast(ast, ast.root(), &mut symbol_table);
+    symbol_table
+}
+
+// Helper function to perform semantic analysis
+fn semantic_analysis(ast: &Ast, symbol_table: &SymbolTable) -> Result<(), String> {
+    fn check_node(ast: &Ast, id: NodeId, table: &SymbolTable) -> Result<(), String> {
+        match *ast.node(id) {
+            ASTNode::BinaryOperation { left, right, .. } => {
+                check_node(ast, left, table)?;
+                check_node(ast, right, table)?;
+                // Add type checking for binary operations
+            }
+            ASTNode::UnaryOperation { operand, .. } => {
+                check_node(ast, operand, table)?;
+                // Add type checking for unary operations
+            }
+            ASTNode::Identifier(name) => {
+                if !table.contains_key(&name) {
+                    return Err(format!("Undefined variable: {}", name));
+                }
+            }
+            ASTNode::FunctionDeclaration { body, .. } => {
+                // Check function body
+                check_node(ast, body, table)?;
+            }
+            ASTNode::Program(nodes) | ASTNode::Block(nodes) => {
+                for &node in ast.list(nodes) {
+                    check_node(ast, node, table)?;
+                }
+            }
+            _ => {}
+        }
+        Ok(())
+    }
+
+    check_node(ast, ast.root(), symbol_table)
+}
+
+// AST optimization pass: rewrites the arena in place and returns how many nodes it changed
+struct OptPass {
+    name: &'static str,
+    min_level: u8,
+    run: fn(&mut Ast) -> usize,
+}
+
+// Passes in pipeline order; -O1 folds and simplifies, -O2 also removes dead code
+const OPT_PASSES: [OptPass; 4] = [
+    OptPass { name: "constant-fold", min_level: 1, run: fold_constants },
+    OptPass { name: "simplify", min_level: 1, run: simplify_algebra },
+    OptPass { name: "dead-code", min_level: 2, run: remove_dead_statements },
+    OptPass { name: "dead-store", min_level: 2, run: eliminate_dead_stores },
+];
+
+// Wall time and rewrite count of one optimization pass
+#[derive(Debug, Clone, Copy)]
+struct PassTiming {
+    name: &'static str,
+    elapsed: Duration,
+    changes: usize,
+}
+
+// Helper function to optimize AST
+fn optimize_ast(ast: &mut Ast, opt_level: u8) -> Vec<PassTiming> {
+    OPT_PASSES
+        .iter()
+        .filter(|pass| opt_level >= pass.min_level)
+        .map(|pass| {
+            let start = Instant::now();
+            let changes = (pass.run)(ast);
+            PassTiming {
+                name: pass.name,
+                elapsed: start.elapsed(),
+                changes,
+            }
+        })
+        .collect()
+}
+
+fn literal_value(ast: &Ast, id: NodeId) -> Option<i64> {
+    match *ast.node(id) {
+        ASTNode::Literal(value) => value.as_str().parse().ok(),
+        _ => None,
+    }
+}
+
+fn int_literal(value: i64) -> ASTNode {
+    ASTNode::Literal(Symbol::intern(&value.to_string()))
+}
+
+// Fold one operation whose operands are integer literals, with the target's wrapping semantics
+fn fold_node(ast: &mut Ast, id: NodeId) -> bool {
+    let folded = match *ast.node(id) {
+        ASTNode::BinaryOperation { left, operator, right } => {
+            let (Some(a), Some(b)) = (literal_value(ast, left), literal_value(ast, right)) else {
+                return false;
+            };
+            match operator {
+                BinaryOp::Assign => None,
+                BinaryOp::Add => Some(a.wrapping_add(b)),
+                BinaryOp::Subtract => Some(a.wrapping_sub(b)),
+                BinaryOp::Multiply => Some(a.wrapping_mul(b)),
+                // Division by zero and i64::MIN / -1 trap at run time; leave them alone
+                BinaryOp::Divide => a.checked_div(b),
+                BinaryOp::Equal => Some((a == b) as i64),
+                BinaryOp::NotEqual => Some((a != b) as i64),
+                BinaryOp::Less => Some((a < b) as i64),
+                BinaryOp::LessEqual => Some((a <= b) as i64),
+                BinaryOp::Greater => Some((a > b) as i64),
+                BinaryOp::GreaterEqual => Some((a >= b) as i64),
+            }
+        }
+        ASTNode::UnaryOperation { operator, operand } => literal_value(ast, operand).map(|a| match operator {
+            UnaryOp::Negate => a.wrapping_neg(),
+            UnaryOp::Not => (a == 0) as i64,
+        }),
+        _ => None,
+    };
+    match folded {
+        Some(value) => {
+            *ast.node_mut(id) = int_literal(value);
+            true
+        }
+        None => false,
+    }
+}
+
+// Constant folding. Children always precede their parents in the arena, so one forward
+// sweep over the node vector folds every operand before the operation that uses it.
+fn fold_constants(ast: &mut Ast) -> usize {
+    let mut changes = 0;
+    for index in 0..ast.nodes.len() {
+        if fold_node(ast, NodeId(index as u32)) {
+            changes += 1;
+        }
+    }
+    changes
+}
+
+// Algebraic simplification: x+0, 0+x, x-0, x*1, 1*x, x/1, --x become x, and x*0 becomes 0
+// when x has no side effects. Rewrites that expose new literal operands are refolded.
+fn simplify_algebra(ast: &mut Ast) -> usize {
+    // Whether each node is free of side effects, filled in as the sweep reaches it
+    let mut pure = vec![true; ast.nodes.len()];
+    let mut changes = 0;
+    for index in 0..ast.nodes.len() {
+        let id = NodeId(index as u32);
+        if fold_node(ast, id) {
+            changes += 1;
+        }
+        let replacement = match *ast.node(id) {
+            ASTNode::BinaryOperation { left, operator, right } => {
+                let (a, b) = (literal_value(ast, left), literal_value(ast, right));
+                match (operator, a, b) {
+                    (BinaryOp::Add, _, Some(0)) | (BinaryOp::Subtract, _, Some(0)) => Some(*ast.node(left)),
+                    (BinaryOp::Multiply, _, Some(1)) | (BinaryOp::Divide, _, Some(1)) => Some(*ast.node(left)),
+                    (BinaryOp::Add, Some(0), _) | (BinaryOp::Multiply, Some(1), _) => Some(*ast.node(right)),
+                    (BinaryOp::Multiply, _, Some(0)) if pure[left.0 as usize] => Some(int_literal(0)),
+                    (BinaryOp::Multiply, Some(0), _) if pure[right.0 as usize] => Some(int_literal(0)),
+                    _ => None,
+                }
+            }
+            ASTNode::UnaryOperation { operator: UnaryOp::Negate, operand } => match *ast.node(operand) {
+                ASTNode::UnaryOperation { operator: UnaryOp::Negate, operand: inner } => Some(*ast.node(inner)),
+                _ => None,
+            },
+            _ => None,
+        };
+        if let Some(node) = replacement {
+            *ast.node_mut(id) = node;
+            changes += 1;
+        }
+        pure[index] = match *ast.node(id) {
+            ASTNode::BinaryOperation { operator: BinaryOp::Assign, .. } => false,
+            ASTNode::BinaryOperation { left, right, .. } => pure[left.0 as usize] && pure[right.0 as usize],
+            ASTNode::UnaryOperation { operand, .. } => pure[operand.0 as usize],
+            _ => true,
+        };
+    }
+    changes
+}
+
+// Whether evaluating an expression can change program state (only assignment can)
+fn has_side_effects(ast: &Ast, id: NodeId) -> bool {
+    match *ast.node(id) {
+        ASTNode::BinaryOperation { operator: BinaryOp::Assign, .. } => true,
+        ASTNode::BinaryOperation { left, right, .. } => has_side_effects(ast, left) || has_side_effects(ast, right),
+        ASTNode::UnaryOperation { operand, .. } => has_side_effects(ast, operand),
+        ASTNode::Expression(expr) => has_side_effects(ast, expr),
+        _ => false,
+    }
+}
+
+// Function bodies reachable from the root, in program order
+fn function_bodies(ast: &Ast) -> Vec<NodeId> {
+    let ASTNode::Program(declarations) = *ast.node(ast.root()) else {
+        return Vec::new();
+    };
+    ast.list(declarations)
+        .iter()
+        .filter_map(|&decl| match *ast.node(decl) {
+            ASTNode::FunctionDeclaration { body, .. } => Some(body),
+            _ => None,
+        })
+        .collect()
+}
+
+// Drop block statements whose result is discarded and which have no side effects.
+// The language has no branches or returns, so no statement is unreachable in the
+// control-flow sense; effect-free statements are the code that can never matter.
+fn remove_dead_statements(ast: &mut Ast) -> usize {
+    let mut changes = 0;
+    for body in function_bodies(ast) {
+        let ASTNode::Block(statements) = *ast.node(body) else { continue };
+        let kept = ast.retain_list(statements, |ast, stmt| match *ast.node(stmt) {
+            ASTNode::Expression(_) => has_side_effects(ast, stmt),
+            _ => true,
+        });
+        changes += (statements.len - kept.len) as usize;
+        *ast.node_mut(body) = ASTNode::Block(kept);
+    }
+    changes
+}
+
+// Count identifier reads in an expression; assignment targets are writes, not reads
+fn count_reads(ast: &Ast, id: NodeId, reads: &mut HashMap<Symbol, isize, FnvBuildHasher>, delta: isize) {
+    let mut stack = vec![id];
+    while let Some(id) = stack.pop() {
+        match *ast.node(id) {
+            ASTNode::Identifier(name) => {
+                *reads.entry(name).or_insert(0) += delta;
+            }
+            ASTNode::BinaryOperation { left, operator: BinaryOp::Assign, right } => {
+                if !matches!(ast.node(left), ASTNode::Identifier(_)) {
+                    stack.push(left);
+                }
+                stack.push(right);
+            }
+            ASTNode::BinaryOperation { left, right, .. } => {
+                stack.push(left);
+                stack.push(right);
+            }
+            ASTNode::UnaryOperation { operand, .. } | ASTNode::Expression(operand) => stack.push(operand),
+            ASTNode::VariableDeclaration { initializer: Some(init), .. } => stack.push(init),
+            _ => {}
+        }
+    }
+}
+
+// Remove local variable declarations nobody reads. An initializer with side effects is
+// kept as an expression statement. Top-level declarations are globals visible to other
+// files, and locals share storage with same-named globals, so neither is touched.
+fn eliminate_dead_stores(ast: &mut Ast) -> usize {
+    let ASTNode::Program(declarations) = *ast.node(ast.root()) else {
+        return 0;
+    };
+    let mut reads: HashMap<Symbol, isize, FnvBuildHasher> = HashMap::default();
+    let mut globals: HashMap<Symbol, (), FnvBuildHasher> = HashMap::default();
+    for &decl in ast.list(declarations) {
+        match *ast.node(decl) {
+            ASTNode::VariableDeclaration { name, .. } => {
+                globals.insert(name, ());
+                count_reads(ast, decl, &mut reads, 1);
+            }
+            ASTNode::FunctionDeclaration { body, .. } => {
+                if let ASTNode::Block(statements) = *ast.node(body) {
+                    for &stmt in ast.list(statements) {
+                        count_reads(ast, stmt, &mut reads, 1);
+                    }
+                }
+            }
+            _ => {}
+        }
+    }
+
+    // Walk statements last to first so removing a declaration can free the ones it reads
+    let mut removed = vec![false; ast.nodes.len()];
+    let mut changes = 0;
+    for body in function_bodies(ast).into_iter().rev() {
+        let ASTNode::Block(statements) = *ast.node(body) else { continue };
+        for index in (0..statements.len as usize).rev() {
+            let stmt = ast.list(statements)[index];
+            let ASTNode::VariableDeclaration { name, initializer, .. } = *ast.node(stmt) else { continue };
+            if reads.get(&name).copied().unwrap_or(0) > 0 || globals.contains_key(&name) {
+                continue;
+            }
+            count_reads(ast, stmt, &mut reads, -1);
+            match initializer {
+                Some(init) if has_side_effects(ast, init) => {
+                    count_reads(ast, init, &mut reads, 1);
+                    *ast.node_mut(stmt) = ASTNode::Expression(init);
+                }
+                _ => removed[stmt.0 as usize] = true,
+            }
+            changes += 1;
+        }
+        let kept = ast.retain_list(statements, |_, stmt| !removed[stmt.0 as usize]);
+        *ast.node_mut(body) = ASTNode::Block(kept);
+    }
+    changes
+}
+
+// IR opcodes for a stack machine; binary operators pop two values and push one
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u8)]
+enum Opcode {
+    Function,
+    Param,
+    EndFunction,
+    Push,
+    Load,
+    Store,
+    Pop,
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Equal,
+    NotEqual,
+    Less,
+    LessEqual,
+    Greater,
+    GreaterEqual,
+    Not,
+    Negate,
+}
+
+impl Opcode {
+    // Every opcode, indexed by its discriminant
+    const ALL: [Opcode; 19] = [
+        Opcode::Function,
+        Opcode::Param,
+        Opcode::EndFunction,
+        Opcode::Push,
+        Opcode::Load,
+        Opcode::Store,
+        Opcode::Pop,
+        Opcode::Add,
+        Opcode::Subtract,
+        Opcode::Multiply,
+        Opcode::Divide,
+        Opcode::Equal,
+        Opcode::NotEqual,
+        Opcode::Less,
+        Opcode::LessEqual,
+        Opcode::Greater,
+        Opcode::GreaterEqual,
+        Opcode::Not,
+        Opcode::Negate,
+    ];
+
+    fn from_binary(op: BinaryOp) -> Option<Opcode> {
+        Some(match op {
+            BinaryOp::Assign => return None,
+            BinaryOp::Equal => Opcode::Equal,
+            BinaryOp::NotEqual => Opcode::NotEqual,
+            BinaryOp::Less => Opcode::Less,
+            BinaryOp::LessEqual => Opcode::LessEqual,
+            BinaryOp::Greater => Opcode::Greater,
+            BinaryOp::GreaterEqual => Opcode::GreaterEqual,
+            BinaryOp::Add => Opcode::Add,
+            BinaryOp::Subtract => Opcode::Subtract,
+            BinaryOp::Multiply => Opcode::Multiply,
+            BinaryOp::Divide => Opcode::Divide,
+        })
+    }
+
+    fn from_unary(op: UnaryOp) -> Opcode {
+        match op {
+            UnaryOp::Not => Opcode::Not,
+            UnaryOp::Negate => Opcode::Negate,
+        }
+    }
+
+    // Opcodes whose operand is a symbol (a name or a literal's text)
+    fn has_operand(self) -> bool {
+        matches!(
+            self,
+            Opcode::Function | Opcode::Param | Opcode::Push | Opcode::Load | Opcode::Store
+        )
+    }
+
+    fn mnemonic(self) -> &'static str {
+        match self {
+            Opcode::Function => "function",
+            Opcode::Param => "param",
+            Opcode::EndFunction => "end_function",
+            Opcode::Push => "push",
+            Opcode::Load => "load",
+            Opcode::Store => "store",
+            Opcode::Pop => "pop",
+            Opcode::Add => "add",
+            Opcode::Subtract => "sub",
+            Opcode::Multiply => "mul",
+            Opcode::Divide => "div",
+            Opcode::Equal => "eq",
+            Opcode::NotEqual => "ne",
+            Opcode::Less => "lt",
+            Opcode::LessEqual => "le",
+            Opcode::Greater => "gt",
+            Opcode::GreaterEqual => "ge",
+            Opcode::Not => "not",
+            Opcode::Negate => "neg",
+        }
+    }
+}
+
+// One IR instruction: an opcode and a symbol operand (unused by operators)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct Inst {
+    op: Opcode,
+    operand: Symbol,
+}
+
+// Flat instruction buffer produced by generate_ir
+#[derive(Debug, Default)]
+struct Ir {
+    insts: Vec<Inst>,
+}
+
+impl Ir {
+    fn emit(&mut self, op: Opcode) {
+        self.insts.push(Inst { op, operand: sym::EOF });
+    }
+
+    fn emit_with(&mut self, op: Opcode, operand: Symbol) {
+        self.insts.push(Inst { op, operand });
+    }
+
+    fn len(&self) -> usize {
+        self.insts.len()
+    }
+
+    // Text form for debugging, one instruction per line
+    fn dump(&self) -> String {
+        use std::fmt::Write;
+        let mut out = String::new();
+        for inst in &self.insts {
+            let indent = if inst.op == Opcode::Function || inst.op == Opcode::EndFunction { "" } else { "  " };
+            if inst.op.has_operand() {
+                let _ = writeln!(out, "{}{} {}", indent, inst.op.mnemonic(), inst.operand);
+            } else {
+                let _ = writeln!(out, "{}{}", indent, inst.op.mnemonic());
+            }
+        }
+        out
+    }
+}
+
+// Helper function to generate intermediate representation (IR)
+fn generate_ir(ast: &Ast) -> Ir {
+    let mut ir = Ir::default();
+
+    fn generate_node_ir(ast: &Ast, id: NodeId, ir: &mut Ir) {
+        match *ast.node(id) {
+            ASTNode::FunctionDeclaration { name, parameters, body, .. } => {
+                ir.emit_with(Opcode::Function, name);
+                for &param in ast.list(parameters) {
+                    if let ASTNode::VariableDeclaration { name, .. } = *ast.node(param) {
+                        ir.emit_with(Opcode::Param, name);
+                    }
+                }
+                generate_node_ir(ast, body, ir);
+                ir.emit(Opcode::EndFunction);
+            }
+            ASTNode::Program(statements) | ASTNode::Block(statements) => {
+                for &stmt in ast.list(statements) {
+                    generate_node_ir(ast, stmt, ir);
+                }
+            }
+            ASTNode::Expression(expr) => {
+                // Expression statements discard their value
+                generate_node_ir(ast, expr, ir);
+                ir.emit(Opcode::Pop);
+            }
+            ASTNode::VariableDeclaration { name, initializer, .. } => {
+                if let Some(init) = initializer {
+                    generate_node_ir(ast, init, ir);
+                    ir.emit_with(Opcode::Store, name);
+                }
+            }
+            ASTNode::BinaryOperation { left, operator, right } => match Opcode::from_binary(operator) {
+                Some(op) => {
+                    generate_node_ir(ast, left, ir);
+                    generate_node_ir(ast, right, ir);
+                    ir.emit(op);
+                }
+                None => {
+                    // Assignment stores into its target and yields the stored value
+                    generate_node_ir(ast, right, ir);
+                    if let ASTNode::Identifier(name) = *ast.node(left) {
+                        ir.emit_with(Opcode::Store, name);
+                        ir.emit_with(Opcode::Load, name);
+                    }
+                }
+            },
+            ASTNode::UnaryOperation { operator, operand } => {
+                generate_node_ir(ast, operand, ir);
+                ir.emit(Opcode::from_unary(operator));
+            }
+            ASTNode::Literal(value) => {
+                ir.emit_with(Opcode::Push, value);
+            }
+            ASTNode::Identifier(name) => {
+                ir.emit_with(Opcode::Load, name);
+            }
+            _ => {}
+        }
+    }
+
+    generate_node_ir(ast, ast.root(), &mut ir);
+    ir
+}
+
+// Helper function to generate target code (e.g., x86 assembly)
+fn generate_target_code(ir: &Ir) -> String {
+    use std::fmt::Write;
+    // About two lines of 16 bytes per IR instruction; one buffer for the whole file
+    let mut asm = String::with_capacity(ir.len() * 32);
+
+    for inst in &ir.insts {
+        match inst.op {
+            Opcode::Function => {
+                let _ = writeln!(asm, "{}:", inst.operand);
+                asm.push_str("    push rbp\n");
+                asm.push_str("    mov rbp, rsp\n");
+            }
+            Opcode::EndFunction => {
+                asm.push_str("    mov rsp, rbp\n");
+                asm.push_str("    pop rbp\n");
+                asm.push_str("    ret\n");
+            }
+            Opcode::Param => {
+                // Handle parameter passing
+            }
+            Opcode::Push => {
+                let _ = writeln!(asm, "    push {}", inst.operand);
+            }
+            Opcode::Load => {
+                let _ = writeln!(asm, "    mov rax, [{}]", inst.operand);
+                asm.push_str("    push rax\n");
+            }
+            Opcode::Store => {
+                asm.push_str("    pop rax\n");
+                let _ = writeln!(asm, "    mov [{}], rax", inst.operand);
+            }
+            Opcode::Pop => {
+                asm.push_str("    add rsp, 8\n");
+            }
+            Opcode::Add | Opcode::Subtract | Opcode::Multiply | Opcode::Divide => {
+                asm.push_str("    pop rbx\n");
+                asm.push_str("    pop rax\n");
+                match inst.op {
+                    Opcode::Add => asm.push_str("    add rax, rbx\n"),
+                    Opcode::Subtract => asm.push_str("    sub rax, rbx\n"),
+                    Opcode::Multiply => asm.push_str("    imul rax, rbx\n"),
+                    _ => {
+                        asm.push_str("    cqo\n");
+                        asm.push_str("    idiv rbx\n");
+                    }
+                }
+                asm.push_str("    push rax\n");
+            }
+            Opcode::Equal
+            | Opcode::NotEqual
+            | Opcode::Less
+            | Opcode::LessEqual
+            | Opcode::Greater
+            | Opcode::GreaterEqual => {
+                let set = match inst.op {
+                    Opcode::Equal => "sete",
+                    Opcode::NotEqual => "setne",
+                    Opcode::Less => "setl",
+                    Opcode::LessEqual => "setle",
+                    Opcode::Greater => "setg",
+                    _ => "setge",
+                };
+                asm.push_str("    pop rbx\n");
+                asm.push_str("    pop rax\n");
+                asm.push_str("    cmp rax, rbx\n");
+                let _ = writeln!(asm, "    {} al", set);
+                asm.push_str("    movzx rax, al\n");
+                asm.push_str("    push rax\n");
+            }
+            Opcode::Not => {
+                asm.push_str("    pop rax\n");
+                asm.push_str("    test rax, rax\n");
+                asm.push_str("    sete al\n");
+                asm.push_str("    movzx rax, al\n");
+                asm.push_str("    push rax\n");
+            }
+            Opcode::Negate => {
+                asm.push_str("    pop rax\n");
+                asm.push_str("    neg rax\n");
+                asm.push_str("    push rax\n");
+            }
+        }
+    }
+
+    asm
+}
+
+// Value of a three-address instruction operand
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Value {
+    Imm(i64),
+    // Non-integer literal, emitted verbatim as the -O0 emitter does
+    Const(Symbol),
+    Vreg(u32),
+}
+
+// Three-address form of the IR: the operand stack resolved into virtual registers
+#[derive(Debug, Clone, Copy)]
+enum VInst {
+    Enter(Symbol),
+    Leave,
+    Load { dst: u32, var: Symbol },
+    Store { var: Symbol, src: Value },
+    Binary { op: Opcode, dst: u32, lhs: Value, rhs: Value },
+    Unary { op: Opcode, dst: u32, src: Value },
+}
+
+impl VInst {
+    fn dst(&self) -> Option<u32> {
+        match *self {
+            VInst::Load { dst, .. } | VInst::Binary { dst, .. } | VInst::Unary { dst, .. } => Some(dst),
+            _ => None,
+        }
+    }
+
+    fn for_each_use(&self, mut f: impl FnMut(u32)) {
+        let mut visit = |value: Value| {
+            if let Value::Vreg(v) = value {
+                f(v);
+            }
+        };
+        match *self {
+            VInst::Store { src, .. } | VInst::Unary { src, .. } => visit(src),
+            VInst::Binary { lhs, rhs, .. } => {
+                visit(lhs);
+                visit(rhs);
+            }
+            _ => {}
+        }
+    }
+}
+
+// Simulate the operand stack so every pushed value becomes a virtual register
+fn lower_to_vregs(ir: &Ir) -> (Vec<VInst>, u32) {
+    let mut code = Vec::with_capacity(ir.len());
+    let mut stack: Vec<Value> = Vec::new();
+    let mut vregs = 0u32;
+    let mut fresh = || {
+        vregs += 1;
+        vregs - 1
+    };
+
+    for inst in &ir.insts {
+        match inst.op {
+            Opcode::Function => code.push(VInst::Enter(inst.operand)),
+            Opcode::EndFunction => code.push(VInst::Leave),
+            Opcode::Param => {}
+            Opcode::Push => stack.push(match inst.operand.as_str().parse::<i64>() {
+                Ok(value) => Value::Imm(value),
+                Err(_) => Value::Const(inst.operand),
+            }),
+            Opcode::Load => {
+                let dst = fresh();
+                code.push(VInst::Load { dst, var: inst.operand });
+                stack.push(Value::Vreg(dst));
+            }
+            Opcode::Store => {
+                let src = stack.pop().expect("IR stack underflow");
+                code.push(VInst::Store { var: inst.operand, src });
+            }
+            Opcode::Pop => {
+                stack.pop().expect("IR stack underflow");
+            }
+            Opcode::Not | Opcode::Negate => {
+                let src = stack.pop().expect("IR stack underflow");
+                let dst = fresh();
+                code.push(VInst::Unary { op: inst.op, dst, src });
+                stack.push(Value::Vreg(dst));
+            }
+            op => {
+                let rhs = stack.pop().expect("IR stack underflow");
+                let lhs = stack.pop().expect("IR stack underflow");
+                let dst = fresh();
+                code.push(VInst::Binary { op, dst, lhs, rhs });
+                stack.push(Value::Vreg(dst));
+            }
+        }
+    }
+
+    // Drop computations whose result is never used. Definitions precede uses,
+    // so a single backward sweep sees every use before the definition.
+    let mut uses = vec![0u32; vregs as usize];
+    for inst in &code {
+        inst.for_each_use(|v| uses[v as usize] += 1);
+    }
+    let mut live = vec![true; code.len()];
+    for (i, inst) in code.iter().enumerate().rev() {
+        if let Some(dst) = inst.dst() {
+            if uses[dst as usize] == 0 {
+                live[i] = false;
+                inst.for_each_use(|v| uses[v as usize] -= 1);
+            }
+        }
+    }
+    let mut keep = live.into_iter();
+    code.retain(|_| keep.next().unwrap_or(true));
+    (code, vregs)
+}
+
+// x86-64 general-purpose registers used by the backend
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Reg {
+    Rax,
+    Rcx,
+    Rsi,
+    Rdi,
+    R8,
+    R9,
+    R10,
+    R11,
+    Rbp,
+    Rsp,
+}
+
+impl Reg {
+    fn name(self) -> &'static str {
+        match self {
+            Reg::Rax => "rax",
+            Reg::Rcx => "rcx",
+            Reg::Rsi => "rsi",
+            Reg::Rdi => "rdi",
+            Reg::R8 => "r8",
+            Reg::R9 => "r9",
+            Reg::R10 => "r10",
+            Reg::R11 => "r11",
+            Reg::Rbp => "rbp",
+            Reg::Rsp => "rsp",
+        }
+    }
+}
+
+// Registers handed out by the allocator. rax is reserved for division, comparisons
+// and spill traffic, r11 for wide immediates; rdx is never allocated since cqo/idiv clobber it.
+const ALLOCATABLE_REGS: [Reg; 6] = [Reg::Rcx, Reg::Rsi, Reg::Rdi, Reg::R8, Reg::R9, Reg::R10];
+
+// Machine operand: a register, an immediate, a literal, a named variable or a spill slot
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Operand {
+    Reg(Reg),
+    Imm(i64),
+    Const(Symbol),
+    Var(Symbol),
+    Slot(u32),
+}
+
+impl Operand {
+    fn is_mem(self) -> bool {
+        matches!(self, Operand::Var(_) | Operand::Slot(_))
+    }
+
+    // Usable directly as the source of an ALU instruction
+    fn is_encodable(self) -> bool {
+        match self {
+            Operand::Imm(value) => i32::try_from(value).is_ok(),
+            Operand::Const(_) => false,
+            _ => true,
+        }
+    }
+}
+
+impl fmt::Display for Operand {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match *self {
+            Operand::Reg(reg) => f.write_str(reg.name()),
+            Operand::Imm(value) => write!(f, "{}", value),
+            Operand::Const(symbol) => write!(f, "{}", symbol),
+            Operand::Var(symbol) => write!(f, "qword [{}]", symbol),
+            Operand::Slot(slot) => write!(f, "qword [rbp - {}]", 8 * (slot + 1)),
+        }
+    }
+}
+
+// One x86-64 instruction as emitted by the optimizing backend
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum MachInst {
+    Label(Symbol),
+    Push(Operand),
+    Pop(Operand),
+    Mov(Operand, Operand),
+    // Two-operand ALU instruction: add, sub, imul, cmp, test, xor, shl
+    Alu(&'static str, Operand, Operand),
+    Imul3(Reg, Operand, i64),
+    // lea dst, [base + base * scale]
+    Lea(Reg, Reg, u8),
+    Neg(Operand),
+    Idiv(Operand),
+    Cqo,
+    Setcc(&'static str),
+    MovzxAl(Reg),
+    Ret,
+}
+
+impl fmt::Display for MachInst {
+    fn fmt(&self, f: &mut fmt::Formatter<'_>) -> fmt::Result {
+        match *self {
+            MachInst::Label(name) => write!(f, "{}:", name),
+            MachInst::Push(op) => write!(f, "    push {}", op),
+            MachInst::Pop(op) => write!(f, "    pop {}", op),
+            MachInst::Mov(dst, src) => write!(f, "    mov {}, {}", dst, src),
+            MachInst::Alu(name, dst, src) => write!(f, "    {} {}, {}", name, dst, src),
+            MachInst::Imul3(dst, src, value) => write!(f, "    imul {}, {}, {}", dst.name(), src, value),
+            MachInst::Lea(dst, base, scale) => {
+                write!(f, "    lea {}, [{} + {}*{}]", dst.name(), base.name(), base.name(), scale)
+            }
+            MachInst::Neg(op) => write!(f, "    neg {}", op),
+            MachInst::Idiv(op) => write!(f, "    idiv {}", op),
+            MachInst::Cqo => f.write_str("    cqo"),
+            MachInst::Setcc(name) => write!(f, "    {} al", name),
+            MachInst::MovzxAl(reg) => write!(f, "    movzx {}, al", reg.name()),
+            MachInst::Ret => f.write_str("    ret"),
+        }
+    }
+}
+
+// Where a virtual register lives for its whole interval
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Location {
+    Reg(Reg),
+    Slot(u32),
+}
+
+// Split three-address code into frames: each function, and each run of top-level code
+fn split_frames(code: &[VInst]) -> Vec<std::ops::Range<usize>> {
+    let mut frames = Vec::new();
+    let mut start = 0;
+    for (i, inst) in code.iter().enumerate() {
+        match inst {
+            VInst::Enter(_) => {
+                if start < i {
+                    frames.push(start..i);
+                }
+                start = i;
+            }
+            VInst::Leave => {
+                frames.push(start..i + 1);
+                start = i + 1;
+            }
+            _ => {}
+        }
+    }
+    if start < code.len() {
+        frames.push(start..code.len());
+    }
+    frames
+}
+
+// Live interval ends: the index of each vreg's last use (or its definition if unused)
+fn interval_ends(code: &[VInst], vregs: u32) -> Vec<usize> {
+    let mut end = vec![0usize; vregs as usize];
+    for (i, inst) in code.iter().enumerate() {
+        if let Some(dst) = inst.dst() {
+            end[dst as usize] = i;
+        }
+        inst.for_each_use(|v| end[v as usize] = i);
+    }
+    end
+}
+
+// Linear-scan register allocation (Poletto & Sarkar) over one frame.
+// Fills in a location for every vreg defined in the frame and returns the spill slot count.
+fn allocate_registers(code: &[VInst], frame: std::ops::Range<usize>, end: &[usize], locations: &mut [Location]) -> u32 {
+    let mut free_regs: Vec<Reg> = ALLOCATABLE_REGS.iter().rev().copied().collect();
+    let mut free_slots: Vec<u32> = Vec::new();
+    let mut slots_used = 0u32;
+    // Intervals currently holding a register, and spilled intervals holding a slot
+    let mut active: Vec<u32> = Vec::new();
+    let mut spilled: Vec<u32> = Vec::new();
+
+    for i in frame {
+        let Some(dst) = code[i].dst() else { continue };
+        active.retain(|&v| {
+            if end[v as usize] >= i {
+                return true;
+            }
+            if let Location::Reg(reg) = locations[v as usize] {
+                free_regs.push(reg);
+            }
+            false
+        });
+        spilled.retain(|&v| {
+            if end[v as usize] >= i {
+                return true;
+            }
+            if let Location::Slot(slot) = locations[v as usize] {
+                free_slots.push(slot);
+            }
+            false
+        });
+        // The destination may reuse the register of a first operand that dies here:
+        // instruction selection reads it into the destination before touching the rest.
+        let first = match code[i] {
+            VInst::Binary { lhs: Value::Vreg(v), .. } | VInst::Unary { src: Value::Vreg(v), .. } => Some(v),
+            _ => None,
+        };
+        if let Some(v) = first.filter(|&v| end[v as usize] == i) {
+            if let Some(index) = active.iter().position(|&a| a == v) {
+                active.swap_remove(index);
+                if let Location::Reg(reg) = locations[v as usize] {
+                    free_regs.push(reg);
+                }
+            }
+        }
+
+        if let Some(reg) = free_regs.pop() {
+            locations[dst as usize] = Location::Reg(reg);
+            active.push(dst);
+            continue;
+        }
+        let slot = free_slots.pop().unwrap_or_else(|| {
+            slots_used += 1;
+            slots_used - 1
+        });
+        // Spill whichever interval ends last: the victim's register goes to the new
+        // interval if the victim outlives it, otherwise the new interval is spilled.
+        let (index, victim) = active
+            .iter()
+            .copied()
+            .enumerate()
+            .max_by_key(|&(_, v)| end[v as usize])
+            .expect("no allocatable registers");
+        if end[victim as usize] > end[dst as usize] {
+            locations[dst as usize] = locations[victim as usize];
+            locations[victim as usize] = Location::Slot(slot);
+            active[index] = dst;
+            spilled.push(victim);
+        } else {
+            locations[dst as usize] = Location::Slot(slot);
+            spilled.push(dst);
+        }
+    }
+    slots_used
+}
+
+// Instruction selection for the optimizing backend
+struct CodeEmitter<'a> {
+    locations: &'a [Location],
+    out: Vec<MachInst>,
+}
+
+impl<'a> CodeEmitter<'a> {
+    fn operand(&self, value: Value) -> Operand {
+        match value {
+            Value::Imm(value) => Operand::Imm(value),
+            Value::Const(symbol) => Operand::Const(symbol),
+            Value::Vreg(v) => self.location(v),
+        }
+    }
+
+    fn location(&self, vreg: u32) -> Operand {
+        match self.locations[vreg as usize] {
+            Location::Reg(reg) => Operand::Reg(reg),
+            Location::Slot(slot) => Operand::Slot(slot),
+        }
+    }
+
+    fn emit(&mut self, inst: MachInst) {
+        self.out.push(inst);
+    }
+
+    // Operand usable as an ALU source, loading wide immediates and literals into r11
+    fn source(&mut self, op: Operand) -> Operand {
+        if op.is_encodable() {
+            op
+        } else {
+            self.emit(MachInst::Mov(Operand::Reg(Reg::R11), op));
+            Operand::Reg(Reg::R11)
+        }
+    }
+
+    // Register to compute into: the destination itself, or rax when it was spilled
+    fn work_reg(dst: Operand) -> Reg {
+        match dst {
+            Operand::Reg(reg) => reg,
+            _ => Reg::Rax,
+        }
+    }
+
+    fn finish(&mut self, dst: Operand, work: Reg) {
+        self.emit(MachInst::Mov(dst, Operand::Reg(work)));
+    }
+
+    fn frame_enter(&mut self, slots: u32) {
+        self.emit(MachInst::Push(Operand::Reg(Reg::Rbp)));
+        self.emit(MachInst::Mov(Operand::Reg(Reg::Rbp), Operand::Reg(Reg::Rsp)));
+        // Keep rsp 16-byte aligned after the rbp push
+        let bytes = (8 * slots as i64 + 15) & !15;
+        self.emit(MachInst::Alu("sub", Operand::Reg(Reg::Rsp), Operand::Imm(bytes)));
+    }
+
+    fn frame_leave(&mut self) {
+        self.emit(MachInst::Mov(Operand::Reg(Reg::Rsp), Operand::Reg(Reg::Rbp)));
+        self.emit(MachInst::Pop(Operand::Reg(Reg::Rbp)));
+    }
+
+    // work = x * value, reduced to moves, shifts and lea where the constant allows
+    fn multiply_const(&mut self, work: Reg, x: Operand, value: i64) {
+        let w = Operand::Reg(work);
+        if let Operand::Imm(k) = x {
+            self.emit(MachInst::Mov(w, Operand::Imm(k.wrapping_mul(value))));
+            return;
+        }
+        if value == 0 {
+            self.emit(MachInst::Alu("xor", w, w));
+            return;
+        }
+        if value == 1 || value == -1 {
+            self.emit(MachInst::Mov(w, x));
+            if value == -1 {
+                self.emit(MachInst::Neg(w));
+            }
+            return;
+        }
+        let shift = value.trailing_zeros();
+        let odd = value >> shift;
+        if value > 0 && matches!(odd, 1 | 3 | 5 | 9) {
+            self.emit(MachInst::Mov(w, x));
+            if odd > 1 {
+                self.emit(MachInst::Lea(work, work, (odd - 1) as u8));
+            }
+            if shift > 0 {
+                self.emit(MachInst::Alu("shl", w, Operand::Imm(shift as i64)));
+            }
+        } else if i32::try_from(value).is_ok() && x.is_encodable() {
+            self.emit(MachInst::Imul3(work, x, value));
+        } else {
+            self.emit(MachInst::Mov(w, x));
+            let factor = self.source(Operand::Imm(value));
+            self.emit(MachInst::Alu("imul", w, factor));
+        }
+    }
+
+    fn binary(&mut self, op: Opcode, dst: Operand, lhs: Operand, rhs: Operand) {
+        let work = Self::work_reg(dst);
+        let w = Operand::Reg(work);
+        match op {
+            Opcode::Add | Opcode::Subtract => {
+                // Put an immediate on the right of commutative additions
+                let (lhs, rhs) = match (op, lhs, rhs) {
+                    (Opcode::Add, Operand::Imm(_), r) if !matches!(r, Operand::Imm(_)) => (r, lhs),
+                    _ => (lhs, rhs),
+                };
+                self.emit(MachInst::Mov(w, lhs));
+                let src = self.source(rhs);
+                let name = if op == Opcode::Add { "add" } else { "sub" };
+                self.emit(MachInst::Alu(name, w, src));
+            }
+            Opcode::Multiply => match (lhs, rhs) {
+                (x, Operand::Imm(value)) | (Operand::Imm(value), x) => self.multiply_const(work, x, value),
+                _ => {
+                    self.emit(MachInst::Mov(w, lhs));
+                    let src = self.source(rhs);
+                    self.emit(MachInst::Alu("imul", w, src));
+                }
+            },
+            Opcode::Divide => {
+                self.emit(MachInst::Mov(Operand::Reg(Reg::Rax), lhs));
+                self.emit(MachInst::Cqo);
+                let divisor = if rhs.is_mem() || matches!(rhs, Operand::Reg(_)) {
+                    rhs
+                } else {
+                    self.emit(MachInst::Mov(Operand::Reg(Reg::R11), rhs));
+                    Operand::Reg(Reg::R11)
+                };
+                self.emit(MachInst::Idiv(divisor));
+                self.emit(MachInst::Mov(w, Operand::Reg(Reg::Rax)));
+            }
+            _ => {
+                let set = match op {
+                    Opcode::Equal => "sete",
+                    Opcode::NotEqual => "setne",
+                    Opcode::Less => "setl",
+                    Opcode::LessEqual => "setle",
+                    Opcode::Greater => "setg",
+                    _ => "setge",
+                };
+                self.emit(MachInst::Mov(Operand::Reg(Reg::Rax), lhs));
+                let src = self.source(rhs);
+                self.emit(MachInst::Alu("cmp", Operand::Reg(Reg::Rax), src));
+                self.emit(MachInst::Setcc(set));
+                self.emit(MachInst::MovzxAl(work));
+            }
+        }
+        if work == Reg::Rax {
+            self.finish(dst, work);
+        }
+    }
+
+    fn unary(&mut self, op: Opcode, dst: Operand, src: Operand) {
+        let work = Self::work_reg(dst);
+        let w = Operand::Reg(work);
+        if op == Opcode::Negate {
+            self.emit(MachInst::Mov(w, src));
+            self.emit(MachInst::Neg(w));
+        } else {
+            self.emit(MachInst::Mov(Operand::Reg(Reg::Rax), src));
+            self.emit(MachInst::Alu("test", Operand::Reg(Reg::Rax), Operand::Reg(Reg::Rax)));
+            self.emit(MachInst::Setcc("sete"));
+            self.emit(MachInst::MovzxAl(work));
+        }
+        if work == Reg::Rax {
+            self.finish(dst, work);
+        }
+    }
+
+    // Emit one frame; functions without spills and top-level code without spills get no frame setup
+    fn frame(&mut self, code: &[VInst], slots: u32) {
+        let function = match code.first() {
+            Some(&VInst::Enter(name)) => Some(name),
+            _ => None,
+        };
+        if let Some(name) = function {
+            self.emit(MachInst::Label(name));
+        }
+        if slots > 0 {
+            self.frame_enter(slots);
+        }
+        for inst in code {
+            match *inst {
+                VInst::Enter(_) | VInst::Leave => {}
+                VInst::Load { dst, var } => {
+                    let d = self.location(dst);
+                    let work = Self::work_reg(d);
+                    self.emit(MachInst::Mov(Operand::Reg(work), Operand::Var(var)));
+                    if work == Reg::Rax {
+                        self.finish(d, work);
+                    }
+                }
+                VInst::Store { var, src } => {
+                    let s = self.operand(src);
+                    if s.is_mem() || !s.is_encodable() {
+                        self.emit(MachInst::Mov(Operand::Reg(Reg::Rax), s));
+                        self.emit(MachInst::Mov(Operand::Var(var), Operand::Reg(Reg::Rax)));
+                    } else {
+                        self.emit(MachInst::Mov(Operand::Var(var), s));
+                    }
+                }
+                VInst::Binary { op, dst, lhs, rhs } => {
+                    let (d, l, r) = (self.location(dst), self.operand(lhs), self.operand(rhs));
+                    self.binary(op, d, l, r);
+                }
+                VInst::Unary { op, dst, src } => {
+                    let (d, s) = (self.location(dst), self.operand(src));
+                    self.unary(op, d, s);
+                }
+            }
+        }
+        if slots > 0 {
+            self.frame_leave();
+        }
+        if function.is_some() {
+            self.emit(MachInst::Ret);
+        }
+    }
+}
+
+// Peephole pass over the emitted code; repeats until nothing changes
+fn peephole(code: &mut Vec<MachInst>) {
+    loop {
+        let mut changed = false;
+        let mut out: Vec<MachInst> = Vec::with_capacity(code.len());
+        for &inst in code.iter() {
+            let rewritten = match (out.last().copied(), inst) {
+                // push x; pop y  =>  mov y, x
+                (Some(MachInst::Push(src)), MachInst::Pop(dst)) if !(src.is_mem() && dst.is_mem()) => {
+                    out.pop();
+                    Some(MachInst::Mov(dst, src))
+                }
+                // mov [v], r; mov r2, [v]  =>  mov [v], r; mov r2, r
+                (Some(MachInst::Mov(Operand::Var(a), Operand::Reg(r))), MachInst::Mov(dst @ Operand::Reg(_), Operand::Var(b)))
+                    if a == b =>
+                {
+                    Some(MachInst::Mov(dst, Operand::Reg(r)))
+                }
+                // mov a, b; mov b, a  =>  mov a, b
+                (Some(MachInst::Mov(a, b)), MachInst::Mov(c, d)) if a == d && b == c => {
+                    changed = true;
+                    continue;
+                }
+                _ => None,
+            };
+            let inst = match rewritten {
+                Some(new) => {
+                    changed = true;
+                    new
+                }
+                None => inst,
+            };
+            // mov x, x
+            if let MachInst::Mov(dst, src) = inst {
+                if dst == src {
+                    changed = true;
+                    continue;
+                }
+            }
+            out.push(inst);
+        }
+        *code = out;
+        if !changed {
+            break;
+        }
+    }
+}
+
+// Optimizing backend: three-address lowering, linear-scan allocation, peephole
+fn generate_optimized_code(ir: &Ir) -> String {
+    use std::fmt::Write;
+    let (code, vregs) = lower_to_vregs(ir);
+    let end = interval_ends(&code, vregs);
+    let mut locations = vec![Location::Slot(0); vregs as usize];
+    let frames: Vec<_> = split_frames(&code)
+        .into_iter()
+        .map(|frame| {
+            let slots = allocate_registers(&code, frame.clone(), &end, &mut locations);
+            (frame, slots)
+        })
+        .collect();
+    let mut emitter = CodeEmitter { locations: &locations, out: Vec::new() };
+    for (frame, slots) in frames {
+        emitter.frame(&code[frame], slots);
+    }
+    let mut out = emitter.out;
+    peephole(&mut out);
+    let mut asm = String::with_capacity(out.len() * 20);
+    for inst in &out {
+        let _ = writeln!(asm, "{}", inst);
+    }
+    asm
+}
+
+// Backend entry point: -O0 keeps the naive stack emitter, higher levels allocate registers.
+// Either way the result is the file's assembly text, one instruction per line.
+fn emit_target_code(ir: &Ir, opt_level: u8) -> String {
+    if opt_level == 0 {
+        generate_target_code(ir)
+    } else {
+        generate_optimized_code(ir)
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    fn lex(source: &[u8]) -> Result<Vec<Token>, String> {
+        Lexer::new(source).tokenize()
+    }
+
+    // Random text from fragments that exercise every lexeme, including the multi-line
+    // ones (strings) and those that end at a newline (comments)
+    fn fragments(rng: &mut CorpusRng, count: usize) -> String {
+        const FRAGMENTS: [&str; 24] = [
+            "let", "fn", "x", "count_a", "_y2", "42", "3.25", "0", "+", "-", "->", "==", "=", "!", "<=", "/",
+            "(", "}", ";", " ", "\n", "\t", "\"a\nb\"", "// note\n",
+        ];
+        (0..count).map(|_| FRAGMENTS[rng.below(FRAGMENTS.len())]).collect()
+    }
+
+    #[test]
+    fn relex_matches_a_fresh_lex() {
+        let mut rng = CorpusRng(15);
+        let mut checked = 0;
+        for _ in 0..20_000 {
+            let count = 1 + rng.below(40);
+            let old = fragments(&mut rng, count);
+            let Ok(mut tokens) = lex(old.as_bytes()) else { continue };
+            let start = rng.below(old.len() + 1);
+            let end = start + rng.below(old.len() - start + 1);
+            let count = rng.below(4);
+            let replacement = fragments(&mut rng, count);
+            let new = [&old[..start], &replacement, &old[end..]].concat();
+            let edit = TextEdit { start, old_end: end, new_end: start + replacement.len() };
+
+            let patched = Lexer::relex(new.as_bytes(), &mut tokens, edit).map(|_| tokens);
+            match lex(new.as_bytes()) {
+                Ok(fresh) => assert_eq!(patched.as_ref(), Ok(&fresh), "{:?} -> {:?}", old, new),
+                Err(_) => assert!(patched.is_err(), "{:?} -> {:?}", old, new),
+            }
+            checked += 1;
+        }
+        assert!(checked > 10_000);
+    }
+
+    fn parse(source: &str) -> Ast {
+        Parser::new(lex(source.as_bytes()).unwrap()).parse().unwrap()
+    }
+
+    // Run one pass on `source` and return the dump and the number of changes it reported
+    fn run_pass(pass: fn(&mut Ast) -> usize, source: &str) -> (String, usize) {
+        let mut ast = parse(source);
+        let changes = pass(&mut ast);
+        (ast.dump(), changes)
+    }
+
+    // `pass` rewrites `source` into the program `expected`
+    fn assert_pass(pass: fn(&mut Ast) -> usize, source: &str, expected: &str) {
+        assert_eq!(run_pass(pass, source).0, parse(expected).dump(), "{}", source);
+    }
+
+    #[test]
+    fn constant_fold_evaluates_integer_operations() {
+        assert_pass(fold_constants, "let a: int = 2 * 3 + 10 / 4 - 1;", "let a: int = 7;");
+        assert_pass(fold_constants, "let a: int = (1 < 2) + (2 <= 2) + (3 == 4) + !0 + !7;", "let a: int = 3;");
+        assert_pass(fold_constants, "let a: int = -(5 - 8);", "let a: int = 3;");
+    }
+
+    #[test]
+    fn constant_fold_wraps_like_the_target() {
+        let (dump, _) = run_pass(fold_constants, "let a: int = 9223372036854775807 + 1;");
+        assert!(dump.contains("Literal -9223372036854775808\n"), "{}", dump);
+        let (dump, _) = run_pass(fold_constants, "let a: int = 4611686018427387904 * 4;");
+        assert!(dump.contains("Literal 0\n"), "{}", dump);
+    }
+
+    #[test]
+    fn constant_fold_keeps_trapping_divisions() {
+        assert_eq!(run_pass(fold_constants, "let a: int = 1 / 0;"), (parse("let a: int = 1 / 0;").dump(), 0));
+        // i64::MIN / -1 overflows and traps like a division by zero
+        let (dump, _) = run_pass(fold_constants, "let a: int = (0 - 9223372036854775807 - 1) / -1;");
+        assert!(dump.contains("BinaryOperation /\n      Literal -9223372036854775808\n      Literal -1\n"), "{}", dump);
+    }
+
+    #[test]
+    fn constant_fold_leaves_non_integer_literals() {
+        let source = "let a: int = 1.5 + 2;";
+        assert_eq!(run_pass(fold_constants, source), (parse(source).dump(), 0));
+    }
+
+    #[test]
+    fn simplify_applies_identities() {
+        assert_pass(simplify_algebra, "let a: int = b + 0 - 0;", "let a: int = b;");
+        assert_pass(simplify_algebra, "let a: int = 1 * b / 1 * 1;", "let a: int = b;");
+        assert_pass(simplify_algebra, "let a: int = --b;", "let a: int = b;");
+        assert_pass(simplify_algebra, "let a: int = 1.5 * 1;", "let a: int = 1.5;");
+        // Rewrites expose literals that are folded in the same sweep
+        assert_pass(simplify_algebra, "let a: int = (b * 0) + 2;", "let a: int = 2;");
+    }
+
+    #[test]
+    fn simplify_keeps_side_effects_under_multiply_by_zero() {
+        let source = "fn f(b: int) -> int { b * 0 * (b = 3); (b = 3) * 0; }";
+        assert_eq!(run_pass(simplify_algebra, source).0, parse("fn f(b: int) -> int { 0 * (b = 3); (b = 3) * 0; }").dump());
+    }
+
+    #[test]
+    fn dead_code_drops_only_effect_free_statements() {
+        assert_pass(
+            remove_dead_statements,
+            "fn f(a: int) -> int { a + 1; a = 2; b * 0; -(a = b); let c: int = 1; }",
+            "fn f(a: int) -> int { a = 2; -(a = b); let c: int = 1; }",
+        );
+    }
+
+    #[test]
+    fn dead_store_removes_unread_locals_transitively() {
+        assert_eq!(
+            run_pass(eliminate_dead_stores, "fn f(x: int) -> int { let t: int = x; let u: int = t + 1; }"),
+            (parse("fn f(x: int) -> int { }").dump(), 2)
+        );
+    }
+
+    #[test]
+    fn dead_store_keeps_locals_read_anywhere() {
+        // Read by a later assignment, nested in an expression, and from another function
+        for source in [
+            "fn f(x: int) -> int { let t: int = x; x = t + 1; }",
+            "fn f(x: int) -> int { let t: int = 2; x = -(1 + (x = t)); }",
+            "fn f(x: int) -> int { let t: int = 1; } fn g(y: int) -> int { y = t; }",
+            // A global of the same name shares the storage
+            "let t: int = 0; fn f(x: int) -> int { let t: int = x; }",
+        ] {
+            assert_eq!(run_pass(eliminate_dead_stores, source), (parse(source).dump(), 0), "{}", source);
+        }
+    }
+
+    #[test]
+    fn dead_store_keeps_initializer_side_effects() {
+        assert_pass(eliminate_dead_stores, "fn f(x: int) -> int { let t: int = x = 5; }", "fn f(x: int) -> int { x = 5; }");
+        // Writing an unread local is not a read of it
+        assert_pass(eliminate_dead_stores, "fn f(x: int) -> int { let t: int = 1; t = x; }", "fn f(x: int) -> int { t = x; }");
+    }
+
+    #[test]
+    fn exports_are_top_level_declarations() {
+        // A parameter and a local that shadow globals must not change the globals' exports
+        let source = b"let x: int = 1; let y: int = 2; fn f(x: float) -> int { let y: float = x; }";
+        let options = Options::parse(&["dpp".to_string()]).unwrap();
+        let compiled = compile_source(source, &options, false, Profiler::default()).unwrap();
+        let exports: Vec<(&str, &str)> = compiled.exports.iter().map(|(n, s)| (n.as_str(), s.as_str())).collect();
+        assert_eq!(exports, [("x", "int"), ("y", "int"), ("f", "fn(float) -> int")]);
+    }
+
+    // Token file of `source` with its AST, and the byte offset of the node section
+    fn token_file(source: &str) -> (Vec<u8>, usize) {
+        let tokens = lex(source.as_bytes()).unwrap();
+        let bytes = encode_token_file(source.as_bytes(), &tokens, Some(&parse(source))).unwrap();
+        let nodes = TokenFile::open(&bytes).unwrap().sections[TF_NODES].start;
+        (bytes, nodes)
+    }
+
+    #[test]
+    fn token_file_rejects_misplaced_node_kinds() {
+        // Nodes: Type, Literal, VariableDeclaration, Program; the Literal becomes a Type
+        let (mut bytes, nodes) = token_file("let a: int = 1;");
+        let kind = nodes + 4 * TOKEN_FILE_NODE_WORDS;
+        assert_eq!(bytes[kind], 8);
+        bytes[kind] = 3;
+        assert_eq!(read_token_file(&bytes).err().as_deref(), Some("corrupt token file node 2"));
+    }
+
+    #[test]
+    fn token_file_node_kinds_never_reach_the_backends_malformed() {
+        // Every node gets every kind in turn: each file is rejected or compiles at all levels
+        let (bytes, nodes) = token_file("let g: int = 1; fn f(x: int) -> int { let t: int = -x; g = t + 2; x; }");
+        let count = TokenFile::open(&bytes).unwrap().node_count;
+        for i in 0..count {
+            for kind in 0..10u8 {
+                let mut mutated = bytes.clone();
+                mutated[nodes + 4 * TOKEN_FILE_NODE_WORDS * i] = kind;
+                for opt_level in 0..3 {
+                    let mut options = Options::parse(&["dpp".to_string()]).unwrap();
+                    options.opt_level = opt_level;
+                    if let Ok(compiled) = compile_source(&mutated, &options, false, Profiler::default()) {
+                        generate_target_code(&compiled.ir);
+                        generate_optimized_code(&compiled.ir);
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn keyword_files_load_by_the_c_rules() {
+        let path = std::env::temp_dir().join(format!("dpp-keywords-{}", std::process::id()));
+        let load = |contents: &[u8]| {
+            std::fs::write(&path, contents).unwrap();
+            KeywordTable::load(path.to_str().unwrap()).map(|table| table.words.len() - BUILTIN_KEYWORDS.words.len())
+        };
+        assert_eq!(load(b"alpha\r\n\nbeta").unwrap(), 2);
+        // No trimming: " alpha" is a keyword no identifier can match
+        assert_eq!(load(b" alpha\n").unwrap(), 1);
+        assert_eq!(load(&[b'a'; 254]).unwrap(), 1);
+        for rejected in [&b"alpha\nalpha\n"[..], b"fn\n", &[b'a'; 255], &[&[b'a'; 254][..], b"\r\n"].concat()] {
+            assert!(load(rejected).is_err(), "{:?}", String::from_utf8_lossy(rejected));
+        }
+        let _ = std::fs::remove_file(&path);
+    }
+
+    #[test]
+    fn relex_reports_only_the_fresh_range() {
+        let old = b"let a: int = 1;\nlet b: int = 2;\n";
+        let mut tokens = lex(old).unwrap();
+        let new = b"let a: int = 100;\nlet b: int = 2;\n";
+        let fresh = Lexer::relex(new, &mut tokens, TextEdit { start: 13, old_end: 14, new_end: 16 }).unwrap();
+        assert_eq!(tokens, lex(new).unwrap());
+        assert!(fresh.len() <= 3, "{:?}", fresh);
+    }
+}
@@ -2,8 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "string_builder.h"
+
+#define ARROW_REPEAT 100
+
 // Function prototype declarations
-void appendArrowSegment(char **dest, const char *segment, size_t *currentLength, size_t *maxLength);
 void generateArrowString(char **result, size_t *length);
 
 int main() {
@@ -24,20 +27,10 @@ int main() {
     return 0;
 }
 
-void appendArrowSegment(char **dest, const char *segment, size_t *currentLength, size_t *maxLength) {
-    size_t segmentLength = strlen(segment);
-
-    if (*currentLength + segmentLength + 1 > *maxLength) {
-        *maxLength = (*currentLength + segmentLength + 1) * 2;
-        *dest = realloc(*dest, *maxLength);
-        if (*dest == NULL) {
-            fprintf(stderr, "Memory allocation error!\n");
-            exit(EXIT_FAILURE);
-        }
-    }
-
-    strcat(*dest, segment);
-    *currentLength += segmentLength;
+// Function to report an allocation failure and exit
+static void arrowOutOfMemory(void) {
+    fprintf(stderr, "Memory allocation error!\n");
+    exit(EXIT_FAILURE);
 }
 
 void generateArrowString(char **result, size_t *length) {
@@ -46,22 +39,32 @@ void generateArrowString(char **result, size_t *length) {
     };
     size_t numComponents = sizeof(arrowComponents) / sizeof(arrowComponents[0]);
 
-    *length = 0;
-    size_t maxLength = 1024; // Initial allocation size
-    *result = malloc(maxLength);
-
-    if (*result == NULL) {
-        fprintf(stderr, "Memory allocation error!\n");
-        exit(EXIT_FAILURE);
+    // One row: every component followed by the separator
+    const char *row[2 * sizeof(arrowComponents) / sizeof(arrowComponents[0])];
+    size_t rowLength = 0;
+    size_t j;
+    for (j = 0; j < numComponents; j++) {
+        row[2 * j] = arrowComponents[j];
+        row[2 * j + 1] = "---"; // separator
+        rowLength += strlen(arrowComponents[j]) + 3;
     }
 
-    (*result)[0] = '\0'; // Initialize empty string
+    StringBuilder builder;
+    string_builder_init(&builder);
+    if (string_builder_reserve(&builder, rowLength * ARROW_REPEAT) != 0) {
+        arrowOutOfMemory();
+    }
 
-    int i, j;
-    for (i = 0; i < 100; i++) { // Repeat to make it super long
-        for (j = 0; j < numComponents; j++) {
-            appendArrowSegment(result, arrowComponents[j], length, &maxLength);
-            appendArrowSegment(result, "---", length, &maxLength); // separator
+    int i;
+    for (i = 0; i < ARROW_REPEAT; i++) { // Repeat to make it super long
+        if (string_builder_append_all(&builder, row, 2 * numComponents) != 0) {
+            arrowOutOfMemory();
         }
     }
+
+    *length = builder.length;
+    *result = string_builder_finish(&builder);
+    if (*result == NULL) {
+        arrowOutOfMemory();
+    }
 }
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keyword_hash.h"
+
+// Build-time generator for the shared keyword tables.
+// Usage: gen_keywords modules/Index/keywords.txt keywords.h keywords.rs
+
+#define MAX_KEYWORDS 1024
+
+// Function to write the C table
+static void write_c_table(FILE *out, const KeywordTable *table) {
+    fprintf(out, "// Generated by gen_keywords.c from modules/Index/keywords.txt. Do not edit.\n");
+    fprintf(out, "#ifndef KEYWORDS_H\n#define KEYWORDS_H\n\n#include \"keyword_hash.h\"\n\n");
+    fprintf(out, "enum {\n");
+    for (size_t i = 0; i < table->count; i++) {
+        fprintf(out, "    KEYWORD_");
+        for (const char *c = table->words[i]; *c; c++) {
+            fputc(*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c, out);
+        }
+        fprintf(out, " = %zu,\n", i);
+    }
+    fprintf(out, "    KEYWORD_COUNT = %zu\n};\n\n", table->count);
+
+    fprintf(out, "static const char *const keyword_builtin_words[%zu] = {", table->count);
+    for (size_t i = 0; i < table->count; i++) {
+        fprintf(out, "%s\"%s\"", i ? ", " : "", table->words[i]);
+    }
+    fprintf(out, "};\n\nstatic const uint8_t keyword_builtin_lengths[%zu] = {", table->count);
+    for (size_t i = 0; i < table->count; i++) {
+        fprintf(out, "%s%u", i ? ", " : "", table->lengths[i]);
+    }
+    fprintf(out, "};\n\nstatic const uint32_t keyword_builtin_displace[%u] = {", table->bucket_mask + 1);
+    for (uint32_t i = 0; i <= table->bucket_mask; i++) {
+        fprintf(out, "%s%u", i ? ", " : "", table->displace[i]);
+    }
+    fprintf(out, "};\n\nstatic const int16_t keyword_builtin_slots[%u] = {", table->slot_mask + 1);
+    for (uint32_t i = 0; i <= table->slot_mask; i++) {
+        fprintf(out, "%s%d", i ? ", " : "", table->slots[i]);
+    }
+    fprintf(out, "};\n\n");
+    fprintf(out, "static const KeywordTable keyword_builtin = {\n");
+    fprintf(out, "    %uu, %uu, %uu,\n", table->seed, table->bucket_mask, table->slot_mask);
+    fprintf(out, "    keyword_builtin_displace, keyword_builtin_slots,\n");
+    fprintf(out, "    keyword_builtin_words, keyword_builtin_lengths, KEYWORD_COUNT, NULL\n};\n\n");
+    fprintf(out, "#endif // KEYWORDS_H\n");
+}
+
+// Function to write the Rust table (pulled into ParsesIndex.rs with include!)
+static void write_rust_table(FILE *out, const KeywordTable *table) {
+    fprintf(out, "// Generated by gen_keywords.c from modules/Index/keywords.txt. Do not edit.\n\n");
+    fprintf(out, "const KEYWORD_SEED: u32 = %u;\n", table->seed);
+    fprintf(out, "const KEYWORD_WORDS: [&str; %zu] = [", table->count);
+    for (size_t i = 0; i < table->count; i++) {
+        fprintf(out, "%s\"%s\"", i ? ", " : "", table->words[i]);
+    }
+    fprintf(out, "];\nconst KEYWORD_DISPLACE: [u32; %u] = [", table->bucket_mask + 1);
+    for (uint32_t i = 0; i <= table->bucket_mask; i++) {
+        fprintf(out, "%s%u", i ? ", " : "", table->displace[i]);
+    }
+    fprintf(out, "];\nconst KEYWORD_SLOTS: [i16; %u] = [", table->slot_mask + 1);
+    for (uint32_t i = 0; i <= table->slot_mask; i++) {
+        fprintf(out, "%s%d", i ? ", " : "", table->slots[i]);
+    }
+    fprintf(out, "];\n");
+}
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "Usage: %s <keywords.txt> <keywords.h> <keywords.rs>\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = fopen(argv[1], "rb");
+    if (in == NULL) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    static char storage[MAX_KEYWORDS][256];
+    const char *words[MAX_KEYWORDS];
+    char line[sizeof(storage[0])];
+    size_t count = 0, line_number = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        size_t length = strcspn(line, "\r\n");
+        line_number++;
+        if (strchr(line, '\n') == NULL && !feof(in)) {
+            fprintf(stderr, "%s:%zu: line is longer than %zu bytes\n", argv[1], line_number, sizeof(line) - 2);
+            return 1;
+        }
+        line[length] = '\0';
+        if (length == 0) {
+            continue;
+        }
+        for (size_t i = 0; i < count; i++) {
+            if (strcmp(words[i], line) == 0) {
+                fprintf(stderr, "%s:%zu: duplicate keyword '%s'\n", argv[1], line_number, line);
+                return 1;
+            }
+        }
+        if (count == MAX_KEYWORDS) {
+            fprintf(stderr, "%s:%zu: more than %d keywords\n", argv[1], line_number, MAX_KEYWORDS);
+            return 1;
+        }
+        memcpy(storage[count], line, length + 1);
+        words[count] = storage[count];
+        count++;
+    }
+    fclose(in);
+
+    KeywordTable table;
+    if (keyword_table_build(&table, words, count) != 0) {
+        fprintf(stderr, "Cannot build a perfect hash over %zu keywords within %u seeds\n", count, KEYWORD_MAX_SEEDS);
+        return 1;
+    }
+
+    FILE *c_out = fopen(argv[2], "w");
+    FILE *rust_out = fopen(argv[3], "w");
+    if (c_out == NULL || rust_out == NULL) {
+        fprintf(stderr, "Cannot write output tables\n");
+        return 1;
+    }
+    write_c_table(c_out, &table);
+    write_rust_table(rust_out, &table);
+    fclose(c_out);
+    fclose(rust_out);
+    keyword_table_free(&table);
+    return 0;
+}
@@ -0,0 +1,258 @@
+#ifndef KEYWORD_HASH_H
+#define KEYWORD_HASH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Perfect hash over the D++ keyword set (hash-and-displace).
+// A key's 32-bit FNV-1a hash picks a bucket; the bucket's displacement is
+// mixed into the hash to pick a slot, and every keyword owns a distinct slot.
+// The same scheme is mirrored by KeywordTable in ParsesIndex.rs, so tables
+// generated by gen_keywords.c work for both lexers.
+
+#define KEYWORD_MAX_DISPLACE 65536u
+#define KEYWORD_MAX_SEEDS 4096u
+
+typedef struct {
+    uint32_t seed;
+    uint32_t bucket_mask;      // bucket count - 1 (power of two)
+    uint32_t slot_mask;        // slot count - 1 (power of two)
+    const uint32_t *displace;  // per-bucket displacement
+    const int16_t *slots;      // keyword index, or -1 for an empty slot
+    const char *const *words;
+    const uint8_t *lengths;
+    size_t count;
+    void *storage;             // owned allocation for runtime-built tables, NULL otherwise
+} KeywordTable;
+
+// Function to hash a key (FNV-1a, seeded)
+static inline uint32_t keyword_hash(const char *s, size_t length, uint32_t seed) {
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (unsigned char) s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// Function to pick a key's slot from its hash and bucket displacement (murmur3 finalizer)
+static inline uint32_t keyword_slot(uint32_t h, uint32_t displace, uint32_t slot_mask) {
+    h ^= displace;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h & slot_mask;
+}
+
+// Function to look up a keyword; returns its index in the table or -1
+static inline int keyword_lookup(const KeywordTable *table, const char *s, size_t length) {
+    uint32_t h = keyword_hash(s, length, table->seed);
+    int index = table->slots[keyword_slot(h, table->displace[h & table->bucket_mask], table->slot_mask)];
+    if (index < 0 || table->lengths[index] != length || memcmp(table->words[index], s, length) != 0) {
+        return -1;
+    }
+    return index;
+}
+
+static inline uint32_t keyword_pow2_at_least(size_t n) {
+    uint32_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+// Function to build a perfect hash table over `count` distinct words (at most 255 bytes each).
+// The words themselves are not copied and must outlive the table. Returns 0 on success,
+// -1 if allocation fails, a word is too long, or no seed below KEYWORD_MAX_SEEDS works
+// (duplicate words always collide, so they end up here).
+static inline int keyword_table_build(KeywordTable *table, const char *const *words, size_t count) {
+    uint32_t buckets = keyword_pow2_at_least(count / 4 + 1);
+    uint32_t slot_count = keyword_pow2_at_least(count * 2);
+    size_t size = buckets * sizeof(uint32_t) + slot_count * sizeof(int16_t) + count * (sizeof(uint32_t) * 2 + 1);
+    unsigned char *storage;
+
+    if (count > INT16_MAX || (storage = malloc(size)) == NULL) {
+        return -1;
+    }
+    uint32_t *displace = (uint32_t *) storage;
+    uint32_t *hashes = displace + buckets;
+    uint32_t *order = hashes + count;
+    int16_t *slots = (int16_t *) (order + count);
+    uint8_t *lengths = (uint8_t *) (slots + slot_count);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t length = strlen(words[i]);
+        if (length > UINT8_MAX) {
+            free(storage);
+            return -1;
+        }
+        lengths[i] = (uint8_t) length;
+    }
+
+    for (uint32_t seed = 0; seed < KEYWORD_MAX_SEEDS; seed++) {
+        uint32_t bucket_mask = buckets - 1, slot_mask = slot_count - 1;
+        int ok = 1;
+
+        memset(displace, 0, buckets * sizeof(uint32_t));
+        memset(slots, 0xFF, slot_count * sizeof(int16_t));
+        for (size_t i = 0; i < count; i++) {
+            hashes[i] = keyword_hash(words[i], lengths[i], seed);
+            order[i] = (uint32_t) i;
+        }
+
+        // Group keys by bucket (insertion sort: keyword sets are small), then place each bucket
+        for (size_t i = 1; i < count; i++) {
+            uint32_t key = order[i];
+            size_t j = i;
+            while (j > 0 && (hashes[order[j - 1]] & bucket_mask) > (hashes[key] & bucket_mask)) {
+                order[j] = order[j - 1];
+                j--;
+            }
+            order[j] = key;
+        }
+        for (size_t begin = 0; begin < count && ok;) {
+            uint32_t bucket = hashes[order[begin]] & bucket_mask;
+            size_t end = begin;
+            while (end < count && (hashes[order[end]] & bucket_mask) == bucket) {
+                end++;
+            }
+
+            uint32_t d;
+            for (d = 0; d < KEYWORD_MAX_DISPLACE; d++) {
+                size_t k;
+                for (k = begin; k < end; k++) {
+                    uint32_t slot = keyword_slot(hashes[order[k]], d, slot_mask);
+                    if (slots[slot] >= 0) {
+                        break;
+                    }
+                    slots[slot] = (int16_t) order[k];
+                }
+                if (k == end) {
+                    break;
+                }
+                // Undo the partial placement and try the next displacement
+                while (k-- > begin) {
+                    slots[keyword_slot(hashes[order[k]], d, slot_mask)] = -1;
+                }
+            }
+            if (d == KEYWORD_MAX_DISPLACE) {
+                ok = 0;
+                break;
+            }
+            displace[bucket] = d;
+            begin = end;
+        }
+
+        if (ok) {
+            table->seed = seed;
+            table->bucket_mask = bucket_mask;
+            table->slot_mask = slot_mask;
+            table->displace = displace;
+            table->slots = slots;
+            table->words = words;
+            table->lengths = lengths;
+            table->count = count;
+            table->storage = storage;
+            return 0;
+        }
+    }
+    free(storage);
+    return -1;
+}
+
+// Function to release a table built by keyword_table_build or keyword_table_load
+static inline void keyword_table_free(KeywordTable *table) {
+    free(table->storage);
+    table->storage = NULL;
+}
+
+// Function to load a dialect keyword file (one keyword per line) on top of a base set.
+// Builds the table once; call at startup and share the result between lexers. A keyword
+// runs to the first '\r' or '\n' of its line and empty lines are skipped; a line of 255
+// bytes or more (its '\n' not counted) and a keyword already in the base set or listed
+// earlier are errors, reported on stderr. KeywordTable::load in ParsesIndex.rs applies the
+// same rules. Returns 0 on success and -1 on those errors, if the file cannot be read,
+// memory runs out, or no perfect hash is found; nothing is kept on failure.
+static inline int keyword_table_load(KeywordTable *table, const KeywordTable *base, const char *path) {
+    FILE *file = fopen(path, "rb");
+    size_t count = 0, capacity = base->count + 16, line_number = 0;
+    char **words = malloc(capacity * sizeof(char *));
+    char line[256];
+    int failed = 0;
+
+    if (file == NULL || words == NULL) {
+        if (file != NULL) {
+            fclose(file);
+        }
+        free(words);
+        return -1;
+    }
+    for (size_t i = 0; i < base->count; i++) {
+        words[count++] = (char *) base->words[i];
+    }
+    while (!failed && fgets(line, sizeof(line), file) != NULL) {
+        size_t length = strcspn(line, "\r\n");
+        line_number++;
+        if (strchr(line, '\n') == NULL && !feof(file)) {
+            fprintf(stderr, "%s:%zu: line is longer than %zu bytes\n", path, line_number, sizeof(line) - 2);
+            failed = 1;
+            break;
+        }
+        line[length] = '\0';
+        if (length == 0) {
+            continue;
+        }
+        int duplicate = keyword_lookup(base, line, length) >= 0;
+        for (size_t i = base->count; i < count && !duplicate; i++) {
+            duplicate = strcmp(words[i], line) == 0;
+        }
+        if (duplicate) {
+            fprintf(stderr, "%s:%zu: duplicate keyword '%s'\n", path, line_number, line);
+            failed = 1;
+            break;
+        }
+        if (count == capacity) {
+            char **grown = realloc(words, (capacity *= 2) * sizeof(char *));
+            if (grown == NULL) {
+                failed = 1;
+                break;
+            }
+            words = grown;
+        }
+        if ((words[count] = malloc(length + 1)) == NULL) {
+            failed = 1;
+            break;
+        }
+        memcpy(words[count++], line, length + 1);
+    }
+    failed |= ferror(file) != 0;
+    fclose(file);
+
+    if (failed || keyword_table_build(table, (const char *const *) words, count) != 0) {
+        for (size_t i = base->count; i < count; i++) {
+            free(words[i]);
+        }
+        free(words);
+        return -1;
+    }
+    // Keep the loaded words alive with the table: they are released by keyword_table_free_loaded
+    table->words = (const char *const *) words;
+    return 0;
+}
+
+// Function to release a table from keyword_table_load together with its loaded words
+static inline void keyword_table_free_loaded(KeywordTable *table, const KeywordTable *base) {
+    char **words = (char **) table->words;
+    for (size_t i = base->count; i < table->count; i++) {
+        free(words[i]);
+    }
+    free(words);
+    keyword_table_free(table);
+}
+
+#endif // KEYWORD_HASH_H
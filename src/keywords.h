@@ -0,0 +1,33 @@
+// Generated by gen_keywords.c from modules/Index/keywords.txt. Do not edit.
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include "keyword_hash.h"
+
+enum {
+    KEYWORD_FN = 0,
+    KEYWORD_LET = 1,
+    KEYWORD_IF = 2,
+    KEYWORD_ELSE = 3,
+    KEYWORD_WHILE = 4,
+    KEYWORD_RETURN = 5,
+    KEYWORD_FUNCTION = 6,
+    KEYWORD_VAR = 7,
+    KEYWORD_COUNT = 8
+};
+
+static const char *const keyword_builtin_words[8] = {"fn", "let", "if", "else", "while", "return", "function", "var"};
+
+static const uint8_t keyword_builtin_lengths[8] = {2, 3, 2, 4, 5, 6, 8, 3};
+
+static const uint32_t keyword_builtin_displace[4] = {0, 0, 4, 1};
+
+static const int16_t keyword_builtin_slots[16] = {-1, 1, 4, -1, 0, -1, 5, -1, 6, -1, -1, -1, 3, -1, 2, 7};
+
+static const KeywordTable keyword_builtin = {
+    0u, 3u, 15u,
+    keyword_builtin_displace, keyword_builtin_slots,
+    keyword_builtin_words, keyword_builtin_lengths, KEYWORD_COUNT, NULL
+};
+
+#endif // KEYWORDS_H
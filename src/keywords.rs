@@ -0,0 +1,6 @@
+// Generated by gen_keywords.c from modules/Index/keywords.txt. Do not edit.
+
+const KEYWORD_SEED: u32 = 0;
+const KEYWORD_WORDS: [&str; 8] = ["fn", "let", "if", "else", "while", "return", "function", "var"];
+const KEYWORD_DISPLACE: [u32; 4] = [0, 0, 4, 1];
+const KEYWORD_SLOTS: [i16; 16] = [-1, 1, 4, -1, 0, -1, 5, -1, 6, -1, -1, -1, 3, -1, 2, 7];
@@ -0,0 +1,66 @@
+#ifndef BASIC_OBJECT_H
+#define BASIC_OBJECT_H
+
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "functionRegistry.h"
+#include "propertyStore.h"
+
+namespace ding {
+
+// Function table policy for objects without callbacks (adds no members or storage).
+// FunctionTable in functionRegistry.h is the policy for objects with callbacks.
+struct NoFunctions {};
+
+// The property object shared by UnlettedObject, LettedObject and VoidedObject.
+// Store is the property storage policy: any type with PropertyStore's set, emplace,
+// setAll, find, get, has and remove members. Functions is a function table policy whose
+// public members become part of the object's API. Code templated on BasicObject<...>
+// compiles to direct calls into the chosen storage, with no virtual dispatch.
+template <class Store = PropertyStore<>, class Functions = NoFunctions>
+class BasicObject : public Functions {
+public:
+    using StoreType = Store;
+
+    void setProperty(const std::string& key, const std::string& value) { properties.set(key, value); }
+    void setProperty(std::string&& key, std::string&& value) { properties.set(std::move(key), std::move(value)); }
+
+    template <class... Args>
+    std::string& emplaceProperty(std::string_view key, Args&&... args) {
+        return properties.emplace(key, std::forward<Args>(args)...);
+    }
+
+    void setProperties(std::initializer_list<std::pair<std::string_view, std::string_view>> entries) {
+        properties.setAll(entries.begin(), entries.end());
+    }
+
+    template <class Iterator>
+    void setProperties(Iterator first, Iterator last) {
+        properties.setAll(first, last);
+    }
+
+    std::string getProperty(std::string_view key) const { return properties.get(key); }
+
+    // No-copy lookup: the stored value, or nullptr; valid until the object is next modified
+    const std::string* findProperty(std::string_view key) const { return properties.find(key); }
+    std::string* findProperty(std::string_view key) { return properties.find(key); }
+
+    bool hasProperty(std::string_view key) const { return properties.has(key); }
+    void removeProperty(std::string_view key) { properties.remove(key); }
+
+    // Call f with a consistent view of all properties (the store, or a snapshot of it)
+    template <class F>
+    decltype(auto) readProperties(F&& f) const {
+        return properties.read(std::forward<F>(f));
+    }
+
+private:
+    Store properties;
+};
+
+} // namespace ding
+
+#endif // BASIC_OBJECT_H
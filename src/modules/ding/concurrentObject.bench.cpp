@@ -0,0 +1,121 @@
+// Read scaling of shared ding property objects: ConcurrentObject against an
+// UnlettedObject behind one mutex. Each configuration runs reader threads over a
+// shared object for a fixed time, with or without one thread writing continuously.
+// Prints one JSON record per configuration.
+//
+// Build: g++ -O2 -std=c++17 -pthread concurrentObject.bench.cpp -o concurrentObject.bench
+// Usage: concurrentObject.bench [MAX_THREADS] [MILLISECONDS]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "concurrentObject.h"
+#include "obj.h"
+
+namespace {
+
+const char* const kKeys[] = {"name", "type", "x", "y", "visible", "parent"};
+constexpr std::size_t kKeyCount = sizeof(kKeys) / sizeof(kKeys[0]);
+
+// The baseline: a plain object behind a mutex, as callers share objects today
+class LockedObject {
+public:
+    void setProperty(const std::string& key, const std::string& value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        object.setProperty(key, value);
+    }
+
+    bool hasProperty(std::string_view key) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return object.hasProperty(key);
+    }
+
+private:
+    mutable std::mutex mutex;
+    UnlettedObject object;
+};
+
+template <class Object>
+double readsPerSecond(Object& object, unsigned readers, bool writer, int milliseconds) {
+    std::atomic<bool> start{false}, stop{false};
+    std::atomic<unsigned long long> found{0};  // keeps the lookups from being optimized out
+    std::vector<unsigned long long> counts(readers * 8);  // one per 64-byte line
+    std::vector<std::thread> threads;
+
+    for (unsigned t = 0; t < readers; t++) {
+        threads.emplace_back([&, t] {
+            while (!start.load(std::memory_order_acquire)) {
+            }
+            unsigned long long reads = 0, hits = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (std::size_t k = 0; k < kKeyCount; k++) {
+                    hits += object.hasProperty(kKeys[k]);
+                }
+                reads += kKeyCount;
+            }
+            counts[t * 8] = reads;
+            found.fetch_add(hits, std::memory_order_relaxed);
+        });
+    }
+    if (writer) {
+        threads.emplace_back([&] {
+            while (!start.load(std::memory_order_acquire)) {
+            }
+            for (unsigned long long i = 0; !stop.load(std::memory_order_relaxed); i++) {
+                object.setProperty("x", std::to_string(i));
+            }
+        });
+    }
+
+    auto begin = std::chrono::steady_clock::now();
+    start.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    stop.store(true);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+
+    unsigned long long total = 0;
+    for (unsigned t = 0; t < readers; t++) {
+        total += counts[t * 8];
+    }
+    return static_cast<double>(total) / seconds;
+}
+
+template <class Object>
+void run(const char* store, unsigned readers, bool writer, int milliseconds) {
+    Object object;
+    for (std::size_t k = 0; k + 1 < kKeyCount; k++) {
+        object.setProperty(kKeys[k], "value");
+    }
+    double rate = readsPerSecond(object, readers, writer, milliseconds);
+    std::printf("{\"bench\":\"ding-properties\",\"store\":\"%s\",\"readers\":%u,\"writer\":%s,"
+                "\"reads_per_s\":%.0f,\"reads_per_s_per_thread\":%.0f}\n",
+                store, readers, writer ? "true" : "false", rate, rate / readers);
+    std::fflush(stdout);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    unsigned maxThreads = argc > 1 ? static_cast<unsigned>(std::atoi(argv[1])) : std::thread::hardware_concurrency();
+    int milliseconds = argc > 2 ? std::atoi(argv[2]) : 300;
+    if (maxThreads == 0) {
+        maxThreads = 1;
+    }
+
+    for (bool writer : {false, true}) {
+        for (unsigned readers = 1; readers <= maxThreads; readers *= 2) {
+            run<ConcurrentObject>("concurrent", readers, writer, milliseconds);
+            run<LockedObject>("mutex", readers, writer, milliseconds);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef CONCURRENT_OBJECT_H
+#define CONCURRENT_OBJECT_H
+
+#include "basicObject.h"
+#include "concurrentPropertyStore.h"
+
+// Property object safe to share between threads without external locking: readers
+// never block, writers serialize per object (see ding::ConcurrentPropertyStore).
+// findProperty and emplaceProperty are not available; use readProperties instead.
+class ConcurrentObject : public ding::BasicObject<ding::ConcurrentPropertyStore<>> {};
+
+#endif // CONCURRENT_OBJECT_H
@@ -0,0 +1,249 @@
+#ifndef CONCURRENT_PROPERTY_STORE_H
+#define CONCURRENT_PROPERTY_STORE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "propertyStore.h"
+
+namespace ding {
+
+namespace detail {
+
+// Epoch-based reclamation shared by every ConcurrentPropertyStore in the process.
+// A reading thread publishes the global epoch it started in; a retired snapshot is
+// freed once no thread is still reading in an epoch at or before its retirement.
+constexpr std::size_t kReaderSlots = 256;
+
+struct alignas(64) ReaderSlot {
+    std::atomic<std::uint64_t> epoch{0};  // 0 while the thread is not reading
+    std::atomic<bool> owned{false};
+};
+
+struct EpochDomain {
+    std::atomic<std::uint64_t> epoch{1};
+    ReaderSlot slots[kReaderSlots];
+};
+
+inline EpochDomain& epochDomain() {
+    static EpochDomain domain;
+    return domain;
+}
+
+// This thread's reader slot, claimed on first use and released at thread exit.
+// slot is nullptr when more than kReaderSlots threads read at once.
+struct ReaderRegistration {
+    ReaderRegistration() {
+        for (ReaderSlot& candidate : epochDomain().slots) {
+            bool expected = false;
+            if (!candidate.owned.load(std::memory_order_relaxed) &&
+                candidate.owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                slot = &candidate;
+                break;
+            }
+        }
+    }
+
+    ~ReaderRegistration() {
+        if (slot != nullptr) {
+            slot->owned.store(false, std::memory_order_release);
+        }
+    }
+
+    ReaderSlot* slot = nullptr;
+    unsigned depth = 0;
+};
+
+inline ReaderRegistration& readerRegistration() {
+    thread_local ReaderRegistration registration;
+    return registration;
+}
+
+// Marks the calling thread as reading for its lifetime; guards may nest
+class ReadGuard {
+public:
+    ReadGuard() : registration(readerRegistration()) {
+        if (registration.slot != nullptr && registration.depth++ == 0) {
+            // seq_cst: the announcement must be visible before the snapshot pointer is read
+            registration.slot->epoch.store(epochDomain().epoch.load());
+        }
+    }
+
+    ~ReadGuard() {
+        if (registration.slot != nullptr && --registration.depth == 0) {
+            registration.slot->epoch.store(0, std::memory_order_release);
+        }
+    }
+
+    ReadGuard(const ReadGuard&) = delete;
+    ReadGuard& operator=(const ReadGuard&) = delete;
+
+    bool registered() const { return registration.slot != nullptr; }
+
+private:
+    ReaderRegistration& registration;
+};
+
+// Oldest epoch any thread is reading in, or UINT64_MAX if none is reading
+inline std::uint64_t oldestReaderEpoch() {
+    std::uint64_t oldest = UINT64_MAX;
+    for (const ReaderSlot& slot : epochDomain().slots) {
+        std::uint64_t epoch = slot.epoch.load();
+        if (epoch != 0 && epoch < oldest) {
+            oldest = epoch;
+        }
+    }
+    return oldest;
+}
+
+} // namespace detail
+
+// Thread-safe property store (read-copy-update). The properties live in an immutable
+// PropertyStore snapshot. Readers load the current snapshot without taking any lock
+// or writing shared memory beyond their own reader slot. Writers serialize on a
+// per-store mutex, copy the snapshot, apply their change and publish the copy. A
+// write never waits for readers, and the old snapshot is freed after the last reader
+// that could see it has finished.
+//
+// Writes cost a copy of the properties, so objects written as often as they are read
+// are better served by PropertyStore under a lock. There is no find() or emplace():
+// a pointer into a snapshot would dangle after the next write. Use read() to inspect
+// several properties in one consistent snapshot instead.
+template <std::size_t InlineCapacity = 8>
+class ConcurrentPropertyStore {
+public:
+    using Snapshot = PropertyStore<InlineCapacity>;
+
+    ConcurrentPropertyStore() = default;
+
+    ConcurrentPropertyStore(const ConcurrentPropertyStore& other) {
+        other.read([this](const Snapshot& snapshot) {
+            if (!snapshot.empty()) {
+                current.store(new Snapshot(snapshot), std::memory_order_relaxed);
+            }
+        });
+    }
+
+    ConcurrentPropertyStore& operator=(const ConcurrentPropertyStore& other) {
+        if (this != &other) {
+            Snapshot* copy = other.read([](const Snapshot& snapshot) { return new Snapshot(snapshot); });
+            std::lock_guard<std::mutex> lock(writer);
+            publish(copy);
+        }
+        return *this;
+    }
+
+    // Destruction, like any other, must not race with readers or writers
+    ~ConcurrentPropertyStore() {
+        delete current.load(std::memory_order_relaxed);
+        for (auto& entry : retired) {
+            delete entry.first;
+        }
+    }
+
+    // Call f(const Snapshot&) on the current properties. The snapshot cannot change
+    // under f, but must not be kept after it returns; f must not write to this store.
+    template <class F>
+    decltype(auto) read(F&& f) const {
+        detail::ReadGuard guard;
+        if (!guard.registered()) {
+            // Out of reader slots: fall back to excluding writers
+            std::lock_guard<std::mutex> lock(writer);
+            return f(view(current.load(std::memory_order_acquire)));
+        }
+        return f(view(current.load()));
+    }
+
+    template <class Key, class Value>
+    void set(Key&& key, Value&& value) {
+        update([&](Snapshot& next) { next.set(std::forward<Key>(key), std::forward<Value>(value)); });
+    }
+
+    // One copy and one publication for the whole batch
+    template <class Iterator>
+    void setAll(Iterator first, Iterator last) {
+        update([&](Snapshot& next) { next.setAll(first, last); });
+    }
+
+    std::string get(std::string_view key) const {
+        return read([key](const Snapshot& snapshot) { return snapshot.get(key); });
+    }
+
+    bool has(std::string_view key) const {
+        return read([key](const Snapshot& snapshot) { return snapshot.has(key); });
+    }
+
+    void remove(std::string_view key) {
+        std::lock_guard<std::mutex> lock(writer);
+        const Snapshot* snapshot = current.load(std::memory_order_relaxed);
+        if (snapshot != nullptr && snapshot->has(key)) {
+            Snapshot* next = new Snapshot(*snapshot);
+            next->remove(key);
+            publish(next);
+        }
+    }
+
+    std::size_t size() const {
+        return read([](const Snapshot& snapshot) { return snapshot.size(); });
+    }
+
+    bool empty() const { return size() == 0; }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(writer);
+        publish(nullptr);
+    }
+
+private:
+    static const Snapshot& view(const Snapshot* snapshot) {
+        static const Snapshot emptySnapshot{};
+        return snapshot != nullptr ? *snapshot : emptySnapshot;
+    }
+
+    template <class Change>
+    void update(Change&& change) {
+        std::lock_guard<std::mutex> lock(writer);
+        const Snapshot* snapshot = current.load(std::memory_order_relaxed);
+        std::unique_ptr<Snapshot> next(snapshot != nullptr ? new Snapshot(*snapshot) : new Snapshot());
+        change(*next);
+        publish(next.release());
+    }
+
+    // Swap in `next` (nullptr for empty), retire the old snapshot in the epoch that ends
+    // now and free every retired snapshot no reader can still hold. Needs the writer lock.
+    void publish(Snapshot* next) {
+        Snapshot* old = current.exchange(next);
+        if (old != nullptr) {
+            retired.emplace_back(old, detail::epochDomain().epoch.fetch_add(1));
+        }
+        if (retired.empty()) {
+            return;
+        }
+        std::uint64_t oldest = detail::oldestReaderEpoch();
+        std::size_t kept = 0;
+        for (auto& entry : retired) {
+            if (entry.second < oldest) {
+                delete entry.first;
+            } else {
+                retired[kept++] = entry;
+            }
+        }
+        retired.resize(kept);
+    }
+
+    std::atomic<Snapshot*> current{nullptr};
+    mutable std::mutex writer;
+    // Replaced snapshots with the epoch they were retired in
+    std::vector<std::pair<Snapshot*, std::uint64_t>> retired;
+};
+
+} // namespace ding
+
+#endif // CONCURRENT_PROPERTY_STORE_H
@@ -0,0 +1,359 @@
+#ifndef DING_WYXYS_OBJECT_ARRAY_H
+#define DING_WYXYS_OBJECT_ARRAY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../../string_builder.h"
+
+// Define a structure for an object
+typedef struct {
+    int intValue;
+    float floatValue;
+    double doubleValue;
+    char charValue;
+    char stringValue[100];
+} Object;
+
+// Column store for batches of Objects (struct of arrays). Each field has its own
+// contiguous array, so a pass over one field reads only that field's bytes. Strings are
+// kept NUL-terminated in one shared arena and referenced by offset and length, which
+// makes a row 25 bytes plus its text instead of 128.
+// Functions returning int give 0 on success and -1 if memory runs out or the arena would
+// pass 4 GiB; the array is left unchanged on failure.
+typedef struct {
+    size_t count;
+    size_t capacity;
+    int *intValues;
+    float *floatValues;
+    double *doubleValues;
+    char *charValues;
+    uint32_t *stringOffsets;
+    uint32_t *stringLengths;  // without the terminating NUL
+    StringBuilder strings;
+} ObjectArray;
+
+// Sum, minimum and maximum of a column; all zero for an empty array
+typedef struct {
+    long long sum;
+    int min;
+    int max;
+} ObjectIntStats;
+
+typedef struct {
+    double sum;
+    double min;
+    double max;
+} ObjectRealStats;
+
+// Function to initialize an empty array (no allocation until the first append)
+static inline void object_array_init(ObjectArray *array) {
+    memset(array, 0, sizeof *array);
+    string_builder_init(&array->strings);
+}
+
+// Function to release every column and the string arena
+static inline void object_array_free(ObjectArray *array) {
+    free(array->intValues);
+    free(array->floatValues);
+    free(array->doubleValues);
+    free(array->charValues);
+    free(array->stringOffsets);
+    free(array->stringLengths);
+    string_builder_free(&array->strings);
+    object_array_init(array);
+}
+
+// Function to resize one column; the column pointer is only replaced on success
+static inline int object_array_resize_column(void **column, size_t elementSize, size_t capacity) {
+    void *resized = realloc(*column, elementSize * capacity);
+    if (resized == NULL) {
+        return -1;
+    }
+    *column = resized;
+    return 0;
+}
+
+// Function to make room for `count` rows in total
+static inline int object_array_reserve(ObjectArray *array, size_t count) {
+    if (count <= array->capacity) {
+        return 0;
+    }
+    if (count > SIZE_MAX / sizeof(double)) {
+        return -1;
+    }
+    // Columns that grew before a failure keep their larger buffers, which is harmless
+    if (object_array_resize_column((void **) &array->intValues, sizeof(int), count) != 0 ||
+        object_array_resize_column((void **) &array->floatValues, sizeof(float), count) != 0 ||
+        object_array_resize_column((void **) &array->doubleValues, sizeof(double), count) != 0 ||
+        object_array_resize_column((void **) &array->charValues, sizeof(char), count) != 0 ||
+        object_array_resize_column((void **) &array->stringOffsets, sizeof(uint32_t), count) != 0 ||
+        object_array_resize_column((void **) &array->stringLengths, sizeof(uint32_t), count) != 0) {
+        return -1;
+    }
+    array->capacity = count;
+    return 0;
+}
+
+// Function to make room for `additional` more rows, growing geometrically
+static inline int object_array_grow(ObjectArray *array, size_t additional) {
+    if (additional > SIZE_MAX - array->count) {
+        return -1;
+    }
+    size_t needed = array->count + additional;
+    if (needed <= array->capacity) {
+        return 0;
+    }
+    size_t capacity = array->capacity < 16 ? 16 : array->capacity;
+    while (capacity < needed) {
+        capacity = capacity > SIZE_MAX / 2 ? needed : capacity * 2;
+    }
+    return object_array_reserve(array, capacity);
+}
+
+// Function to copy a string (with its NUL) into the arena and report where it went
+static inline int object_array_intern_string(ObjectArray *array, const char *strVal, uint32_t *offset,
+                                             uint32_t *length) {
+    size_t size = strlen(strVal);
+    if (size >= UINT32_MAX || array->strings.length > UINT32_MAX - size - 1) {
+        return -1;
+    }
+    size_t start = array->strings.length;
+    if (string_builder_append_n(&array->strings, strVal, size + 1) != 0) {
+        return -1;
+    }
+    *offset = (uint32_t) start;
+    *length = (uint32_t) size;
+    return 0;
+}
+
+// Function to append one row
+static inline int object_array_push(ObjectArray *array, int intVal, float floatVal, double doubleVal,
+                                    char charVal, const char *strVal) {
+    uint32_t offset, length;
+    if (object_array_grow(array, 1) != 0 || object_array_intern_string(array, strVal, &offset, &length) != 0) {
+        return -1;
+    }
+    size_t i = array->count++;
+    array->intValues[i] = intVal;
+    array->floatValues[i] = floatVal;
+    array->doubleValues[i] = doubleVal;
+    array->charValues[i] = charVal;
+    array->stringOffsets[i] = offset;
+    array->stringLengths[i] = length;
+    return 0;
+}
+
+// Function to append a copy of an Object
+static inline int object_array_push_object(ObjectArray *array, const Object *obj) {
+    return object_array_push(array, obj->intValue, obj->floatValue, obj->doubleValue, obj->charValue,
+                             obj->stringValue);
+}
+
+// Function to append `n` rows with the same values. The string is stored once and
+// shared by all of them; each column is filled by its own loop.
+static inline int object_array_initialize_n(ObjectArray *array, size_t n, int intVal, float floatVal,
+                                            double doubleVal, char charVal, const char *strVal) {
+    uint32_t offset, length;
+    if (n == 0) {
+        return 0;
+    }
+    if (object_array_reserve(array, array->count <= SIZE_MAX - n ? array->count + n : SIZE_MAX) != 0 ||
+        object_array_intern_string(array, strVal, &offset, &length) != 0) {
+        return -1;
+    }
+    size_t start = array->count;
+    size_t end = start + n;
+    for (size_t i = start; i < end; i++) {
+        array->intValues[i] = intVal;
+    }
+    for (size_t i = start; i < end; i++) {
+        array->floatValues[i] = floatVal;
+    }
+    for (size_t i = start; i < end; i++) {
+        array->doubleValues[i] = doubleVal;
+    }
+    memset(array->charValues + start, (unsigned char) charVal, n);
+    for (size_t i = start; i < end; i++) {
+        array->stringOffsets[i] = offset;
+        array->stringLengths[i] = length;
+    }
+    array->count = end;
+    return 0;
+}
+
+// Function to get row i's string (NUL-terminated, inside the arena)
+static inline const char *object_array_string(const ObjectArray *array, size_t i) {
+    return array->strings.data + array->stringOffsets[i];
+}
+
+// Function to copy row i out into an Object, truncating its string to fit
+static inline void object_array_get(const ObjectArray *array, size_t i, Object *obj) {
+    size_t length = array->stringLengths[i];
+    if (length >= sizeof obj->stringValue) {
+        length = sizeof obj->stringValue - 1;
+    }
+    obj->intValue = array->intValues[i];
+    obj->floatValue = array->floatValues[i];
+    obj->doubleValue = array->doubleValues[i];
+    obj->charValue = array->charValues[i];
+    memcpy(obj->stringValue, object_array_string(array, i), length);
+    obj->stringValue[length] = '\0';
+}
+
+// Function to compute sum, min and max of the int column in one pass
+static inline ObjectIntStats object_array_int_stats(const ObjectArray *array) {
+    ObjectIntStats stats = {0, 0, 0};
+    const int *restrict values = array->intValues;
+    size_t count = array->count;
+    if (count == 0) {
+        return stats;
+    }
+    long long sum = 0;
+    int min = values[0], max = values[0];
+    for (size_t i = 0; i < count; i++) {
+        sum += values[i];
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+    }
+    stats.sum = sum;
+    stats.min = min;
+    stats.max = max;
+    return stats;
+}
+
+// Real-valued columns are reduced in four independent lanes: without -ffast-math the
+// compiler may not reorder a single floating-point sum, but it can vectorize the lanes.
+// The results therefore differ from a strict left-to-right sum by rounding only.
+#define OBJECT_ARRAY_LANES 4
+
+// Function to compute sum, min and max of the float column, summing in double
+static inline ObjectRealStats object_array_float_stats(const ObjectArray *array) {
+    ObjectRealStats stats = {0.0, 0.0, 0.0};
+    const float *restrict values = array->floatValues;
+    size_t count = array->count;
+    if (count == 0) {
+        return stats;
+    }
+    double sum[OBJECT_ARRAY_LANES] = {0.0};
+    float min[OBJECT_ARRAY_LANES], max[OBJECT_ARRAY_LANES];
+    for (size_t lane = 0; lane < OBJECT_ARRAY_LANES; lane++) {
+        min[lane] = max[lane] = values[0];
+    }
+    size_t i = 0;
+    for (; i + OBJECT_ARRAY_LANES <= count; i += OBJECT_ARRAY_LANES) {
+        for (size_t lane = 0; lane < OBJECT_ARRAY_LANES; lane++) {
+            float v = values[i + lane];
+            sum[lane] += v;
+            min[lane] = v < min[lane] ? v : min[lane];
+            max[lane] = v > max[lane] ? v : max[lane];
+        }
+    }
+    for (; i < count; i++) {
+        sum[0] += values[i];
+        min[0] = values[i] < min[0] ? values[i] : min[0];
+        max[0] = values[i] > max[0] ? values[i] : max[0];
+    }
+    stats.min = min[0];
+    stats.max = max[0];
+    for (size_t lane = 0; lane < OBJECT_ARRAY_LANES; lane++) {
+        stats.sum += sum[lane];
+        stats.min = min[lane] < stats.min ? min[lane] : stats.min;
+        stats.max = max[lane] > stats.max ? max[lane] : stats.max;
+    }
+    return stats;
+}
+
+// Function to compute sum, min and max of the double column
+static inline ObjectRealStats object_array_double_stats(const ObjectArray *array) {
+    ObjectRealStats stats = {0.0, 0.0, 0.0};
+    const double *restrict values = array->doubleValues;
+    size_t count = array->count;
+    if (count == 0) {
+        return stats;
+    }
+    double sum[OBJECT_ARRAY_LANES] = {0.0}, min[OBJECT_ARRAY_LANES], max[OBJECT_ARRAY_LANES];
+    for (size_t lane = 0; lane < OBJECT_ARRAY_LANES; lane++) {
+        min[lane] = max[lane] = values[0];
+    }
+    size_t i = 0;
+    for (; i + OBJECT_ARRAY_LANES <= count; i += OBJECT_ARRAY_LANES) {
+        for (size_t lane = 0; lane < OBJECT_ARRAY_LANES; lane++) {
+            double v = values[i + lane];
+            sum[lane] += v;
+            min[lane] = v < min[lane] ? v : min[lane];
+            max[lane] = v > max[lane] ? v : max[lane];
+        }
+    }
+    for (; i < count; i++) {
+        sum[0] += values[i];
+        min[0] = values[i] < min[0] ? values[i] : min[0];
+        max[0] = values[i] > max[0] ? values[i] : max[0];
+    }
+    stats.min = min[0];
+    stats.max = max[0];
+    for (size_t lane = 0; lane < OBJECT_ARRAY_LANES; lane++) {
+        stats.sum += sum[lane];
+        stats.min = min[lane] < stats.min ? min[lane] : stats.min;
+        stats.max = max[lane] > stats.max ? max[lane] : stats.max;
+    }
+    return stats;
+}
+
+// Function to collect the indices of rows whose int value lies in [low, high].
+// `indices` needs room for array->count entries; returns how many matched. Every index
+// is written and the count advanced by the comparison, so the loop has no branch.
+static inline size_t object_array_filter_int(const ObjectArray *array, int low, int high, size_t *indices) {
+    const int *restrict values = array->intValues;
+    size_t matched = 0;
+    for (size_t i = 0; i < array->count; i++) {
+        indices[matched] = i;
+        matched += (values[i] >= low) & (values[i] <= high);
+    }
+    return matched;
+}
+
+// Function to collect the indices of rows whose double value lies in [low, high]
+static inline size_t object_array_filter_double(const ObjectArray *array, double low, double high,
+                                                 size_t *indices) {
+    const double *restrict values = array->doubleValues;
+    size_t matched = 0;
+    for (size_t i = 0; i < array->count; i++) {
+        indices[matched] = i;
+        matched += (values[i] >= low) & (values[i] <= high);
+    }
+    return matched;
+}
+
+// Function to append the rows of `source` listed in `indices` (e.g. a filter result).
+// `target` may be `source`: the arena is reserved for every selected string up front, so
+// copying never reallocates it while a source string is being read.
+static inline int object_array_select(ObjectArray *target, const ObjectArray *source, const size_t *indices,
+                                      size_t count) {
+    uint64_t bytes = 0;
+    for (size_t k = 0; k < count && bytes <= UINT32_MAX; k++) {
+        bytes += (uint64_t) source->stringLengths[indices[k]] + 1;
+    }
+    if (bytes > UINT32_MAX - target->strings.length || object_array_grow(target, count) != 0 ||
+        string_builder_reserve(&target->strings, (size_t) bytes) != 0) {
+        return -1;
+    }
+    for (size_t k = 0; k < count; k++) {
+        size_t i = indices[k];
+        uint32_t offset = (uint32_t) target->strings.length, length = source->stringLengths[i];
+        // Cannot fail: the room was reserved above
+        string_builder_append_n(&target->strings, object_array_string(source, i), (size_t) length + 1);
+        size_t j = target->count++;
+        target->intValues[j] = source->intValues[i];
+        target->floatValues[j] = source->floatValues[i];
+        target->doubleValues[j] = source->doubleValues[i];
+        target->charValues[j] = source->charValues[i];
+        target->stringOffsets[j] = offset;
+        target->stringLengths[j] = length;
+    }
+    return 0;
+}
+
+#endif
@@ -1,31 +1,49 @@
 #include <stdio.h>
 #include <string.h>
 
-// Define a structure for an object
-typedef struct {
-    int intValue;
-    float floatValue;
-    double doubleValue;
-    char charValue;
-    char stringValue[100];
-} Object;
-
-// Function to initialize the object
+#include "ding.wyxysObjectArray.h"
+#include "ding.wyxysSerializer.h"
+
+// Function to initialize the object; strings longer than stringValue are truncated
 void initializeObject(Object* obj, int intVal, float floatVal, double doubleVal, char charVal, const char* strVal) {
     obj->intValue = intVal;
     obj->floatValue = floatVal;
     obj->doubleValue = doubleVal;
     obj->charValue = charVal;
-    strcpy(obj->stringValue, strVal);
+    size_t length = strlen(strVal);
+    if (length >= sizeof obj->stringValue) {
+        length = sizeof obj->stringValue - 1;
+    }
+    memcpy(obj->stringValue, strVal, length);
+    obj->stringValue[length] = '\0';
+}
+
+// Function to print the properties of `count` objects with one write per megabyte
+int printObjects(const Object* objects, size_t count) {
+    ObjectSerializer serializer;
+    object_serializer_init(&serializer, stdout, 0);
+    int status = object_serializer_append_objects(&serializer, objects, count);
+    if (object_serializer_flush(&serializer) != 0) {
+        status = -1;
+    }
+    object_serializer_free(&serializer);
+    return status;
 }
 
 // Function to print the object properties
 void printObject(const Object* obj) {
-    printf("Integer Value: %d\n", obj->intValue);
-    printf("Float Value: %.2f\n", obj->floatValue);
-    printf("Double Value: %.5f\n", obj->doubleValue);
-    printf("Character Value: %c\n", obj->charValue);
-    printf("String Value: %s\n", obj->stringValue);
+    printObjects(obj, 1);
+}
+
+// Function to print a summary of the numeric columns of a batch
+void printObjectArrayStats(const ObjectArray* objects) {
+    ObjectIntStats ints = object_array_int_stats(objects);
+    ObjectRealStats floats = object_array_float_stats(objects);
+    ObjectRealStats doubles = object_array_double_stats(objects);
+    printf("Objects: %zu\n", objects->count);
+    printf("Integer Sum/Min/Max: %lld %d %d\n", ints.sum, ints.min, ints.max);
+    printf("Float Sum/Min/Max: %.2f %.2f %.2f\n", floats.sum, floats.min, floats.max);
+    printf("Double Sum/Min/Max: %.5f %.5f %.5f\n", doubles.sum, doubles.min, doubles.max);
 }
 
 int main() {
@@ -38,5 +56,38 @@ int main() {
     // Print the object properties
     printObject(&gSys34);
 
+    // Store a batch column-wise: the object, then 1000 copies of it, then a ramp
+    ObjectArray objects;
+    object_array_init(&objects);
+    if (object_array_push_object(&objects, &gSys34) != 0 ||
+        object_array_initialize_n(&objects, 1000, gSys34.intValue, gSys34.floatValue, gSys34.doubleValue,
+                                  gSys34.charValue, gSys34.stringValue) != 0) {
+        fprintf(stderr, "out of memory\n");
+        object_array_free(&objects);
+        return 1;
+    }
+    for (int i = 0; i < 100; i++) {
+        if (object_array_push(&objects, i, i * 0.5f, i * 0.25, 'a' + i % 26, "ramp") != 0) {
+            fprintf(stderr, "out of memory\n");
+            object_array_free(&objects);
+            return 1;
+        }
+    }
+    printObjectArrayStats(&objects);
+
+    // Filter the ramp rows back out by their integer value and print the last one
+    size_t* matches = malloc(objects.count * sizeof *matches);
+    if (matches != NULL) {
+        size_t matched = object_array_filter_int(&objects, 0, 9, matches);
+        printf("Rows with Integer Value in [0, 9]: %zu\n", matched);
+        if (matched > 0) {
+            Object last;
+            object_array_get(&objects, matches[matched - 1], &last);
+            printObject(&last);
+        }
+        free(matches);
+    }
+    object_array_free(&objects);
+
     return 0;
 }
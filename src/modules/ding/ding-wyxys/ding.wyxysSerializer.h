@@ -0,0 +1,319 @@
+#ifndef DING_WYXYS_SERIALIZER_H
+#define DING_WYXYS_SERIALIZER_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "../../../string_builder.h"
+#include "ding.wyxysObjectArray.h"
+
+// Bulk output for Objects and ObjectArrays. Rows are rendered into one growable buffer
+// that is handed to the stream with a single fwrite once it passes flushBytes (and on
+// object_serializer_flush), instead of five printf calls per object.
+// The text format is byte-for-byte the one printObject has always produced. The binary
+// format is the ObjectArray columns as they are in memory, behind a small header.
+// Functions returning int give 0 on success and -1 if memory runs out or a write fails.
+
+#define OBJECT_SERIALIZER_FLUSH_BYTES (1u << 20)
+
+typedef struct {
+    FILE *out;
+    size_t flushBytes;
+    StringBuilder buffer;
+} ObjectSerializer;
+
+// Function to write an int in decimal; returns the number of characters (at most 11)
+static inline size_t object_format_int(char *out, int value) {
+    static const char digitPairs[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+    char digits[12];
+    char *end = digits + sizeof digits;
+    char *p = end;
+    unsigned int magnitude = value < 0 ? 0u - (unsigned int) value : (unsigned int) value;
+    while (magnitude >= 100) {
+        unsigned int pair = magnitude % 100;
+        magnitude /= 100;
+        p -= 2;
+        memcpy(p, digitPairs + 2 * pair, 2);
+    }
+    if (magnitude >= 10) {
+        p -= 2;
+        memcpy(p, digitPairs + 2 * magnitude, 2);
+    } else {
+        *--p = (char) ('0' + magnitude);
+    }
+    if (value < 0) {
+        *--p = '-';
+    }
+    size_t length = (size_t) (end - p);
+    memcpy(out, p, length);
+    return length;
+}
+
+// Room object_format_fixed needs: the largest double has 309 integer digits, plus
+// sign, point, up to 9 decimals and the NUL snprintf writes
+#define OBJECT_FIXED_MAX 328
+
+// Function to write `value` exactly as printf("%.*f", precision, value) would, for
+// precision 0 to 9; returns the number of characters. Values whose scaled magnitude
+// is below 2^40 are converted with integer arithmetic. Larger values, non-finite ones
+// and those too close to a rounding tie to decide in double are left to snprintf.
+static inline size_t object_format_fixed(char *out, double value, int precision) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+    double scaled = fabs(value) * powers[precision];
+    if (scaled < 1099511627776.0) {  // 2^40: the fraction below is accurate to 2^-13
+        double whole = floor(scaled);
+        double fraction = scaled - whole;
+        if (fabs(fraction - 0.5) > 1e-3) {
+            uint64_t rounded = (uint64_t) whole + (fraction > 0.5);
+            char digits[24];
+            char *end = digits + sizeof digits;
+            char *p = end;
+            for (int i = 0; i < precision; i++) {
+                *--p = (char) ('0' + rounded % 10);
+                rounded /= 10;
+            }
+            if (precision > 0) {
+                *--p = '.';
+            }
+            do {
+                *--p = (char) ('0' + rounded % 10);
+                rounded /= 10;
+            } while (rounded != 0);
+            if (signbit(value)) {
+                *--p = '-';
+            }
+            size_t length = (size_t) (end - p);
+            memcpy(out, p, length);
+            return length;
+        }
+    }
+    int length = snprintf(out, OBJECT_FIXED_MAX, "%.*f", precision, value);
+    return length > 0 ? (size_t) length : 0;
+}
+
+// Function to initialize a serializer writing to `out`; flushBytes 0 picks the default
+static inline void object_serializer_init(ObjectSerializer *serializer, FILE *out, size_t flushBytes) {
+    serializer->out = out;
+    serializer->flushBytes = flushBytes != 0 ? flushBytes : OBJECT_SERIALIZER_FLUSH_BYTES;
+    string_builder_init(&serializer->buffer);
+}
+
+// Function to write out everything buffered, with one fwrite
+static inline int object_serializer_flush(ObjectSerializer *serializer) {
+    StringBuilder *buffer = &serializer->buffer;
+    if (buffer->length == 0) {
+        return 0;
+    }
+    size_t length = buffer->length;
+    size_t written = fwrite(buffer->data, 1, length, serializer->out);
+    buffer->length = 0;
+    buffer->data[0] = '\0';
+    return written == length ? 0 : -1;
+}
+
+// Function to flush once the buffer has reached the flush threshold
+static inline int object_serializer_maybe_flush(ObjectSerializer *serializer) {
+    return serializer->buffer.length >= serializer->flushBytes ? object_serializer_flush(serializer) : 0;
+}
+
+// Function to release the buffer; anything not yet flushed is discarded
+static inline void object_serializer_free(ObjectSerializer *serializer) {
+    string_builder_free(&serializer->buffer);
+}
+
+// Function to append `text` of known length without the NUL bookkeeping of the builder;
+// the caller has reserved room
+static inline char *object_serializer_put(char *p, const char *text, size_t length) {
+    memcpy(p, text, length);
+    return p + length;
+}
+
+// Function to render one row in printObject's text format
+static inline int object_serializer_append_fields(ObjectSerializer *serializer, int intVal, float floatVal,
+                                                  double doubleVal, char charVal, const char *strVal,
+                                                  size_t strLength) {
+    static const char intLabel[] = "Integer Value: ";
+    static const char floatLabel[] = "\nFloat Value: ";
+    static const char doubleLabel[] = "\nDouble Value: ";
+    static const char charLabel[] = "\nCharacter Value: ";
+    static const char stringLabel[] = "\nString Value: ";
+    // Labels, 11 int digits, two fixed-point numbers, the char and the final newline
+    size_t bound = sizeof intLabel + sizeof floatLabel + sizeof doubleLabel + sizeof charLabel +
+                   sizeof stringLabel + 11 + 2 * OBJECT_FIXED_MAX + 2;
+    if (strLength > SIZE_MAX - bound || string_builder_reserve(&serializer->buffer, bound + strLength) != 0) {
+        return -1;
+    }
+    char *start = serializer->buffer.data + serializer->buffer.length;
+    char *p = start;
+    p = object_serializer_put(p, intLabel, sizeof intLabel - 1);
+    p += object_format_int(p, intVal);
+    p = object_serializer_put(p, floatLabel, sizeof floatLabel - 1);
+    p += object_format_fixed(p, floatVal, 2);
+    p = object_serializer_put(p, doubleLabel, sizeof doubleLabel - 1);
+    p += object_format_fixed(p, doubleVal, 5);
+    p = object_serializer_put(p, charLabel, sizeof charLabel - 1);
+    *p++ = charVal;
+    p = object_serializer_put(p, stringLabel, sizeof stringLabel - 1);
+    p = object_serializer_put(p, strVal, strLength);
+    *p++ = '\n';
+    serializer->buffer.length += (size_t) (p - start);
+    serializer->buffer.data[serializer->buffer.length] = '\0';
+    return object_serializer_maybe_flush(serializer);
+}
+
+// Function to append one Object as text
+static inline int object_serializer_append_object(ObjectSerializer *serializer, const Object *obj) {
+    return object_serializer_append_fields(serializer, obj->intValue, obj->floatValue, obj->doubleValue,
+                                           obj->charValue, obj->stringValue, strlen(obj->stringValue));
+}
+
+// Function to append `count` Objects as text
+static inline int object_serializer_append_objects(ObjectSerializer *serializer, const Object *objects,
+                                                   size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (object_serializer_append_object(serializer, &objects[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Function to append every row of an ObjectArray as text
+static inline int object_serializer_append_array(ObjectSerializer *serializer, const ObjectArray *array) {
+    for (size_t i = 0; i < array->count; i++) {
+        if (object_serializer_append_fields(serializer, array->intValues[i], array->floatValues[i],
+                                            array->doubleValues[i], array->charValues[i],
+                                            object_array_string(array, i), array->stringLengths[i]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Binary format, version 1: an ObjectBinaryHeader followed by the columns of `count`
+// rows, widest first so that each one starts aligned when the header is:
+//   double doubleValues[count]
+//   int32  intValues[count]
+//   float  floatValues[count]
+//   uint32 stringOffsets[count], stringLengths[count]
+//   char   charValues[count]
+//   char   strings[stringBytes]  (each string NUL-terminated at offset + length)
+// Everything is in the writer's byte order, recorded in byteOrder.
+#define OBJECT_BINARY_MAGIC "WYXO"
+#define OBJECT_BINARY_VERSION 1u
+#define OBJECT_BINARY_BYTE_ORDER 0x01020304u
+
+_Static_assert(sizeof(int) == sizeof(int32_t), "the binary format stores int as int32");
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t reserved;  // 0
+    uint64_t count;
+    uint64_t stringBytes;
+} ObjectBinaryHeader;
+
+// Function to append an ObjectArray in the binary format
+static inline int object_serializer_append_binary(ObjectSerializer *serializer, const ObjectArray *array) {
+    ObjectBinaryHeader header;
+    memcpy(header.magic, OBJECT_BINARY_MAGIC, sizeof header.magic);
+    header.version = OBJECT_BINARY_VERSION;
+    header.byteOrder = OBJECT_BINARY_BYTE_ORDER;
+    header.reserved = 0;
+    header.count = array->count;
+    header.stringBytes = array->strings.length;
+
+    size_t count = array->count;
+    size_t total = sizeof header + count * (sizeof(double) + sizeof(int32_t) + sizeof(float) +
+                                            2 * sizeof(uint32_t) + 1) + array->strings.length;
+    StringBuilder *buffer = &serializer->buffer;
+    if (string_builder_reserve(buffer, total) != 0) {
+        return -1;
+    }
+    char *start = buffer->data + buffer->length;
+    char *p = start;
+    p = object_serializer_put(p, (const char *) &header, sizeof header);
+    if (count != 0) {
+        p = object_serializer_put(p, (const char *) array->doubleValues, count * sizeof(double));
+        p = object_serializer_put(p, (const char *) array->intValues, count * sizeof(int));
+        p = object_serializer_put(p, (const char *) array->floatValues, count * sizeof(float));
+        p = object_serializer_put(p, (const char *) array->stringOffsets, count * sizeof(uint32_t));
+        p = object_serializer_put(p, (const char *) array->stringLengths, count * sizeof(uint32_t));
+        p = object_serializer_put(p, array->charValues, count);
+    }
+    if (array->strings.length != 0) {
+        p = object_serializer_put(p, array->strings.data, array->strings.length);
+    }
+    buffer->length += (size_t) (p - start);
+    buffer->data[buffer->length] = '\0';
+    return object_serializer_maybe_flush(serializer);
+}
+
+// Function to append the rows of one binary ObjectArray record in `data` to `array`.
+// *consumed is set to the record's size, so concatenated records can be read in turn.
+// Returns -1 for a truncated, foreign or inconsistent record, or if memory runs out.
+static inline int object_array_read_binary(ObjectArray *array, const void *data, size_t size, size_t *consumed) {
+    ObjectBinaryHeader header;
+    const char *bytes = data;
+    if (size < sizeof header) {
+        return -1;
+    }
+    memcpy(&header, bytes, sizeof header);
+    if (memcmp(header.magic, OBJECT_BINARY_MAGIC, sizeof header.magic) != 0 ||
+        header.version != OBJECT_BINARY_VERSION || header.byteOrder != OBJECT_BINARY_BYTE_ORDER) {
+        return -1;
+    }
+    const uint64_t rowBytes = sizeof(double) + sizeof(int32_t) + sizeof(float) + 2 * sizeof(uint32_t) + 1;
+    uint64_t available = size - sizeof header;
+    if (header.count > available / rowBytes || header.stringBytes > available - header.count * rowBytes ||
+        header.stringBytes > UINT32_MAX - array->strings.length) {
+        return -1;
+    }
+    size_t count = (size_t) header.count;
+    size_t stringBytes = (size_t) header.stringBytes;
+    const char *doubles = bytes + sizeof header;
+    const char *ints = doubles + count * sizeof(double);
+    const char *floats = ints + count * sizeof(int32_t);
+    const char *offsets = floats + count * sizeof(float);
+    const char *lengths = offsets + count * sizeof(uint32_t);
+    const char *chars = lengths + count * sizeof(uint32_t);
+    const char *strings = chars + count;
+
+    // Validate every string reference before changing the array
+    for (size_t i = 0; i < count; i++) {
+        uint32_t offset, length;
+        memcpy(&offset, offsets + i * sizeof offset, sizeof offset);
+        memcpy(&length, lengths + i * sizeof length, sizeof length);
+        if (offset >= stringBytes || length >= stringBytes - offset || strings[offset + length] != '\0') {
+            return -1;
+        }
+    }
+    size_t first = array->count;
+    uint32_t base = (uint32_t) array->strings.length;
+    if (object_array_grow(array, count) != 0 || string_builder_append_n(&array->strings, strings, stringBytes) != 0) {
+        return -1;
+    }
+    if (count != 0) {
+        memcpy(array->doubleValues + first, doubles, count * sizeof(double));
+        memcpy(array->intValues + first, ints, count * sizeof(int));
+        memcpy(array->floatValues + first, floats, count * sizeof(float));
+        memcpy(array->stringOffsets + first, offsets, count * sizeof(uint32_t));
+        memcpy(array->stringLengths + first, lengths, count * sizeof(uint32_t));
+        memcpy(array->charValues + first, chars, count);
+    }
+    for (size_t i = first; i < first + count; i++) {
+        array->stringOffsets[i] += base;
+    }
+    array->count += count;
+    *consumed = (size_t) (strings + stringBytes - bytes);
+    return 0;
+}
+
+#endif
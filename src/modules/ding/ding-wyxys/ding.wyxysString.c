@@ -1,6 +1,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "ding.wyxysSerializer.h"
+
 int main() {
     // Integer variable
     int intValue;
@@ -24,12 +26,15 @@ int main() {
     charValue = 'X';
     strcpy(stringValue, "%s%c__str__%f");
 
-    // Print the variables
-    printf("Integer Value: %d\n", intValue);
-    printf("Float Value: %.2f\n", floatValue);
-    printf("Double Value: %.5f\n", doubleValue);
-    printf("Character Value: %c\n", charValue);
-    printf("String Value: %s\n", stringValue);
-
-    return 0;
+    // Print the variables, rendered into one buffer and written at once
+    ObjectSerializer serializer;
+    object_serializer_init(&serializer, stdout, 0);
+    int status = object_serializer_append_fields(&serializer, intValue, floatValue, doubleValue, charValue,
+                                                 stringValue, strlen(stringValue));
+    if (object_serializer_flush(&serializer) != 0) {
+        status = -1;
+    }
+    object_serializer_free(&serializer);
+
+    return status == 0 ? 0 : 1;
 }
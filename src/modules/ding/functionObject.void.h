@@ -1,25 +1,9 @@
 #ifndef VOIDED_OBJECT_H
 #define VOIDED_OBJECT_H
 
-#include <string>
-#include <unordered_map>
-#include <functional>
+#include "basicObject.h"
 
-class VoidedObject {
-public:
-    VoidedObject();
-    ~VoidedObject();
-
-    void setProperty(const std::string& key, const std::string& value);
-    std::string getProperty(const std::string& key) const;
-    bool hasProperty(const std::string& key) const;
-    void removeProperty(const std::string& key);
-
-    void applyToFunction(const std::string& functionName, const std::function<void()>& func);
-
-private:
-    std::unordered_map<std::string, std::string> properties;
-    std::unordered_map<std::string, std::function<void()>> functions;
-};
+// Property object with named callbacks (applyToFunction, from ding::FunctionTable)
+class VoidedObject : public ding::BasicObject<ding::PropertyStore<>, ding::FunctionTable> {};
 
 #endif // VOIDED_OBJECT_H
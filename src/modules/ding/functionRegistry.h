@@ -0,0 +1,275 @@
+#ifndef FUNCTION_REGISTRY_H
+#define FUNCTION_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ding {
+
+// Type-erased void() callable with small-buffer storage: callables of up to Capacity
+// bytes (with a non-throwing move) are stored inline, larger ones on the heap. Calling
+// is one indirect call. Stored callables must be copyable, as with std::function.
+template <std::size_t Capacity = 4 * sizeof(void*)>
+class InlineFunction {
+    static_assert(Capacity >= sizeof(void*), "InlineFunction needs room for a pointer");
+
+public:
+    InlineFunction() = default;
+
+    template <class F, class = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFunction>>>
+    InlineFunction(F&& func) {
+        using Target = std::decay_t<F>;
+        static_assert(std::is_copy_constructible_v<Target>, "callbacks must be copyable");
+        if constexpr (fitsInline<Target>()) {
+            new (buffer_) Target(std::forward<F>(func));
+            invoke_ = &invokeInline<Target>;
+            manage_ = &manageInline<Target>;
+        } else {
+            new (buffer_) Target*(new Target(std::forward<F>(func)));
+            invoke_ = &invokeHeap<Target>;
+            manage_ = &manageHeap<Target>;
+        }
+    }
+
+    InlineFunction(const InlineFunction& other) { copyFrom(other); }
+    InlineFunction(InlineFunction&& other) noexcept { moveFrom(other); }
+    ~InlineFunction() { reset(); }
+
+    InlineFunction& operator=(const InlineFunction& other) {
+        if (this != &other) {
+            InlineFunction copy(other);
+            reset();
+            moveFrom(copy);
+        }
+        return *this;
+    }
+
+    InlineFunction& operator=(InlineFunction&& other) noexcept {
+        if (this != &other) {
+            reset();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    explicit operator bool() const { return invoke_ != nullptr; }
+
+    // Like std::function, a const call may run a mutable target
+    void operator()() const { invoke_(const_cast<unsigned char*>(buffer_)); }
+
+    void reset() {
+        if (manage_ != nullptr) {
+            manage_(Op::Destroy, buffer_, nullptr);
+        }
+        invoke_ = nullptr;
+        manage_ = nullptr;
+    }
+
+private:
+    enum class Op { Move, Copy, Destroy };
+
+    template <class Target>
+    static constexpr bool fitsInline() {
+        return sizeof(Target) <= Capacity && alignof(Target) <= alignof(std::max_align_t) &&
+               std::is_nothrow_move_constructible_v<Target>;
+    }
+
+    template <class Target>
+    static void invokeInline(void* storage) {
+        (*static_cast<Target*>(storage))();
+    }
+
+    template <class Target>
+    static void manageInline(Op op, void* dst, void* src) {
+        switch (op) {
+        case Op::Move:
+            new (dst) Target(std::move(*static_cast<Target*>(src)));
+            static_cast<Target*>(src)->~Target();
+            break;
+        case Op::Copy:
+            new (dst) Target(*static_cast<const Target*>(src));
+            break;
+        case Op::Destroy:
+            static_cast<Target*>(dst)->~Target();
+            break;
+        }
+    }
+
+    template <class Target>
+    static void invokeHeap(void* storage) {
+        (**static_cast<Target**>(storage))();
+    }
+
+    template <class Target>
+    static void manageHeap(Op op, void* dst, void* src) {
+        switch (op) {
+        case Op::Move:
+            new (dst) Target*(*static_cast<Target**>(src));
+            break;
+        case Op::Copy:
+            new (dst) Target*(new Target(**static_cast<Target**>(src)));
+            break;
+        case Op::Destroy:
+            delete *static_cast<Target**>(dst);
+            break;
+        }
+    }
+
+    void copyFrom(const InlineFunction& other) {
+        if (other.manage_ != nullptr) {
+            other.manage_(Op::Copy, buffer_, const_cast<unsigned char*>(other.buffer_));
+            invoke_ = other.invoke_;
+            manage_ = other.manage_;
+        }
+    }
+
+    // The source is left empty; its target was moved out (inline) or handed over (heap)
+    void moveFrom(InlineFunction& other) noexcept {
+        if (other.manage_ != nullptr) {
+            other.manage_(Op::Move, buffer_, other.buffer_);
+            invoke_ = other.invoke_;
+            manage_ = other.manage_;
+            other.invoke_ = nullptr;
+            other.manage_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char buffer_[Capacity];
+    void (*invoke_)(void*) = nullptr;
+    void (*manage_)(Op, void*, void*) = nullptr;
+};
+
+// Process-wide integer id of a function name. Intern names once, at setup time, and
+// dispatch by id: ids compare as integers, with no string hashing per call.
+struct FunctionId {
+    std::uint32_t value;
+
+    bool operator==(FunctionId other) const { return value == other.value; }
+    bool operator!=(FunctionId other) const { return value != other.value; }
+};
+
+namespace detail {
+
+struct FunctionNames {
+    std::mutex mutex;
+    std::unordered_map<std::string, std::uint32_t> ids;
+};
+
+inline FunctionNames& functionNames() {
+    static FunctionNames names;
+    return names;
+}
+
+} // namespace detail
+
+// Id of `name`, assigning the next free one on first use (thread-safe)
+inline FunctionId internFunctionName(std::string_view name) {
+    detail::FunctionNames& names = detail::functionNames();
+    std::lock_guard<std::mutex> lock(names.mutex);
+    auto inserted = names.ids.emplace(std::string(name), static_cast<std::uint32_t>(names.ids.size()));
+    return FunctionId{inserted.first->second};
+}
+
+// Id of `name` if it was ever interned; a name never interned has no registered function
+inline bool lookupFunctionName(std::string_view name, FunctionId& id) {
+    detail::FunctionNames& names = detail::functionNames();
+    std::lock_guard<std::mutex> lock(names.mutex);
+    auto found = names.ids.find(std::string(name));
+    if (found == names.ids.end()) {
+        return false;
+    }
+    id = FunctionId{found->second};
+    return true;
+}
+
+// Pre-resolved reference to one object's callback: calling through it does no lookup.
+// A handle stays valid for the object that resolved it (and copies of that object),
+// since callbacks are never removed and replacing one keeps its place.
+struct FunctionHandle {
+    std::uint32_t slot = 0;  // position + 1; 0 means unresolved
+
+    explicit operator bool() const { return slot != 0; }
+};
+
+// Function table policy for ding::BasicObject: named callbacks registered with
+// applyToFunction and called by name, id or handle. Ids and callbacks are kept in
+// parallel arrays, so finding an id scans a few contiguous integers.
+class FunctionTable {
+public:
+    using Callback = InlineFunction<>;
+
+    // Register any callable (a lambda, function pointer or std::function) under a name,
+    // replacing an earlier one. Small captures are stored with no heap allocation.
+    template <class F>
+    void applyToFunction(std::string_view functionName, F&& func) {
+        setCallback(internFunctionName(functionName), Callback(std::forward<F>(func)));
+    }
+
+    template <class F>
+    void applyToFunction(FunctionId id, F&& func) {
+        setCallback(id, Callback(std::forward<F>(func)));
+    }
+
+    FunctionHandle resolveFunction(FunctionId id) const {
+        for (std::size_t i = 0; i < ids.size(); i++) {
+            if (ids[i] == id.value) {
+                return FunctionHandle{static_cast<std::uint32_t>(i + 1)};
+            }
+        }
+        return FunctionHandle{};
+    }
+
+    FunctionHandle resolveFunction(std::string_view functionName) const {
+        FunctionId id;
+        return lookupFunctionName(functionName, id) ? resolveFunction(id) : FunctionHandle{};
+    }
+
+    bool hasFunction(FunctionId id) const { return static_cast<bool>(resolveFunction(id)); }
+
+    // The handle must be valid for this object. A running callback must not register new
+    // functions on the object that is calling it.
+    void callFunction(FunctionHandle handle) const { callbacks[handle.slot - 1](); }
+
+    // Call by id or name; returns false if no such function is registered
+    bool callFunction(FunctionId id) const {
+        FunctionHandle handle = resolveFunction(id);
+        if (handle) {
+            callFunction(handle);
+        }
+        return static_cast<bool>(handle);
+    }
+
+    bool callFunction(std::string_view functionName) const {
+        FunctionHandle handle = resolveFunction(functionName);
+        if (handle) {
+            callFunction(handle);
+        }
+        return static_cast<bool>(handle);
+    }
+
+private:
+    void setCallback(FunctionId id, Callback&& callback) {
+        FunctionHandle handle = resolveFunction(id);
+        if (handle) {
+            callbacks[handle.slot - 1] = std::move(callback);
+            return;
+        }
+        ids.push_back(id.value);
+        callbacks.push_back(std::move(callback));
+    }
+
+    std::vector<std::uint32_t> ids;
+    std::vector<Callback> callbacks;
+};
+
+} // namespace ding
+
+#endif // FUNCTION_REGISTRY_H
@@ -1,21 +1,9 @@
 #ifndef UNLETTED_OBJECT_H
 #define UNLETTED_OBJECT_H
 
-#include <string>
-#include <unordered_map>
+#include "basicObject.h"
 
-class UnlettedObject {
-public:
-    UnlettedObject();
-    ~UnlettedObject();
-
-    void setProperty(const std::string& key, const std::string& value);
-    std::string getProperty(const std::string& key) const;
-    bool hasProperty(const std::string& key) const;
-    void removeProperty(const std::string& key);
-
-private:
-    std::unordered_map<std::string, std::string> properties;
-};
+// Property object without callbacks, built from the shared ding::BasicObject template
+class UnlettedObject : public ding::BasicObject<> {};
 
 #endif // UNLETTED_OBJECT_H
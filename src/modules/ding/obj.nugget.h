@@ -1,21 +1,9 @@
 #ifndef LETTED_OBJECT_H
 #define LETTED_OBJECT_H
 
-#include <string>
-#include <unordered_map>
+#include "basicObject.h"
 
-class LettedObject {
-public:
-    LettedObject();
-    ~LettedObject();
-
-    void setProperty(const std::string& key, const std::string& value);
-    std::string getProperty(const std::string& key) const;
-    bool hasProperty(const std::string& key) const;
-    void removeProperty(const std::string& key);
-
-private:
-    std::unordered_map<std::string, std::string> properties;
-};
+// Same storage and API as UnlettedObject, but a type of its own for overloading
+class LettedObject : public ding::BasicObject<> {};
 
 #endif // LETTED_OBJECT_H
@@ -0,0 +1,311 @@
+#ifndef PROPERTY_STORE_H
+#define PROPERTY_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace ding {
+
+// Property map with small-object optimization. Up to InlineCapacity entries live in a
+// buffer inside the object and are found by linear scan. Past that, the entries move to
+// one heap array with an open-addressing index over it (linear probing, load <= 1/2).
+// Entries stay dense in both modes: removing one moves the last entry into its place.
+template <std::size_t InlineCapacity = 8>
+class PropertyStore {
+    static_assert(InlineCapacity > 0, "PropertyStore needs at least one inline entry");
+
+public:
+    struct Entry {
+        std::string key;
+        std::string value;
+    };
+
+    PropertyStore() = default;
+    PropertyStore(const PropertyStore& other) { copyFrom(other); }
+    PropertyStore(PropertyStore&& other) noexcept { moveFrom(other); }
+    ~PropertyStore() { clear(); }
+
+    PropertyStore& operator=(const PropertyStore& other) {
+        if (this != &other) {
+            clear();
+            copyFrom(other);
+        }
+        return *this;
+    }
+
+    PropertyStore& operator=(PropertyStore&& other) noexcept {
+        if (this != &other) {
+            clear();
+            moveFrom(other);
+        }
+        return *this;
+    }
+
+    // Key and value may be anything a std::string can be built from (std::string, views,
+    // literals); rvalue strings are moved in, and the key is only copied for a new entry
+    template <class Key, class Value>
+    void set(Key&& key, Value&& value) {
+        std::size_t i = indexOf(std::string_view(key));
+        if (i != npos) {
+            data()[i].value = std::forward<Value>(value);
+        } else {
+            append(Entry{std::string(std::forward<Key>(key)), std::string(std::forward<Value>(value))});
+        }
+    }
+
+    // Set a value built in place from std::string::assign / constructor arguments
+    template <class... Args>
+    std::string& emplace(std::string_view key, Args&&... args) {
+        std::size_t i = indexOf(key);
+        if (i == npos) {
+            append(Entry{std::string(key), std::string(std::forward<Args>(args)...)});
+            return data()[size_ - 1].value;
+        }
+        if constexpr (sizeof...(Args) == 0) {
+            data()[i].value.clear();
+        } else {
+            data()[i].value.assign(std::forward<Args>(args)...);
+        }
+        return data()[i].value;
+    }
+
+    // Set every (key, value) pair of [first, last), reserving room for all of them once
+    template <class Iterator>
+    void setAll(Iterator first, Iterator last) {
+        if constexpr (std::is_base_of_v<std::forward_iterator_tag,
+                                        typename std::iterator_traits<Iterator>::iterator_category>) {
+            reserve(size_ + static_cast<std::size_t>(std::distance(first, last)));
+        }
+        for (; first != last; ++first) {
+            set(first->first, first->second);
+        }
+    }
+
+    // Pointer to the stored value, or nullptr; valid until the store is next modified
+    const std::string* find(std::string_view key) const {
+        std::size_t i = indexOf(key);
+        return i != npos ? &data()[i].value : nullptr;
+    }
+
+    std::string* find(std::string_view key) {
+        std::size_t i = indexOf(key);
+        return i != npos ? &data()[i].value : nullptr;
+    }
+
+    // Missing keys read as the empty string
+    std::string get(std::string_view key) const {
+        const std::string* value = find(key);
+        return value != nullptr ? *value : std::string();
+    }
+
+    bool has(std::string_view key) const { return indexOf(key) != npos; }
+
+    void remove(std::string_view key) {
+        std::size_t i = indexOf(key);
+        if (i == npos) {
+            return;
+        }
+        std::size_t last = size_ - 1;
+        if (heap_ != nullptr) {
+            eraseSlot(slotOf(i, hashOf(data()[i].key)));
+            if (i != last) {
+                index_[slotOf(last, hashOf(data()[last].key))].entry = static_cast<std::uint32_t>(i + 1);
+            }
+        }
+        if (i != last) {
+            data()[i] = std::move(data()[last]);
+        }
+        data()[last].~Entry();
+        size_--;
+    }
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    // Make room for `count` entries in total
+    void reserve(std::size_t count) {
+        if (count > capacity_) {
+            grow(count);
+        }
+    }
+
+    // Call f(const PropertyStore&); the same interface as ConcurrentPropertyStore::read
+    template <class F>
+    decltype(auto) read(F&& f) const {
+        return f(*this);
+    }
+
+    // Entries in no particular order; removal invalidates iterators
+    const Entry* begin() const { return data(); }
+    const Entry* end() const { return data() + size_; }
+
+    // Drop every entry and return to inline storage
+    void clear() {
+        for (std::size_t i = 0; i < size_; i++) {
+            data()[i].~Entry();
+        }
+        if (heap_ != nullptr) {
+            std::allocator<Entry>().deallocate(heap_, capacity_);
+        }
+        heap_ = nullptr;
+        index_.reset();
+        indexMask_ = 0;
+        capacity_ = InlineCapacity;
+        size_ = 0;
+    }
+
+private:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    // Index slot: truncated key hash and entry position + 1 (0 marks an empty slot)
+    struct Slot {
+        std::uint32_t hash;
+        std::uint32_t entry;
+    };
+
+    static std::uint32_t hashOf(std::string_view key) {
+        return static_cast<std::uint32_t>(std::hash<std::string_view>()(key));
+    }
+
+    Entry* data() { return heap_ != nullptr ? heap_ : std::launder(reinterpret_cast<Entry*>(buffer_)); }
+    const Entry* data() const {
+        return heap_ != nullptr ? heap_ : std::launder(reinterpret_cast<const Entry*>(buffer_));
+    }
+
+    std::size_t indexOf(std::string_view key) const {
+        const Entry* entries = data();
+        if (heap_ == nullptr) {
+            for (std::size_t i = 0; i < size_; i++) {
+                if (entries[i].key == key) {
+                    return i;
+                }
+            }
+            return npos;
+        }
+        std::uint32_t hash = hashOf(key);
+        for (std::size_t slot = hash & indexMask_;; slot = (slot + 1) & indexMask_) {
+            const Slot& s = index_[slot];
+            if (s.entry == 0) {
+                return npos;
+            }
+            if (s.hash == hash && entries[s.entry - 1].key == key) {
+                return s.entry - 1;
+            }
+        }
+    }
+
+    // Slot holding entry i, whose key hashes to `hash`
+    std::size_t slotOf(std::size_t i, std::uint32_t hash) const {
+        std::size_t slot = hash & indexMask_;
+        while (index_[slot].entry != i + 1) {
+            slot = (slot + 1) & indexMask_;
+        }
+        return slot;
+    }
+
+    void insertSlot(std::size_t i, std::uint32_t hash) {
+        std::size_t slot = hash & indexMask_;
+        while (index_[slot].entry != 0) {
+            slot = (slot + 1) & indexMask_;
+        }
+        index_[slot] = Slot{hash, static_cast<std::uint32_t>(i + 1)};
+    }
+
+    // Backward-shift deletion: pull later members of the probe run into the hole
+    // whenever the hole lies between their home slot and where they sit
+    void eraseSlot(std::size_t hole) {
+        for (std::size_t next = (hole + 1) & indexMask_; index_[next].entry != 0; next = (next + 1) & indexMask_) {
+            std::size_t home = index_[next].hash & indexMask_;
+            if (((next - home) & indexMask_) >= ((next - hole) & indexMask_)) {
+                index_[hole] = index_[next];
+                hole = next;
+            }
+        }
+        index_[hole] = Slot{0, 0};
+    }
+
+    // Move the entries to a heap array of `capacity` and rebuild the index over it.
+    // The index gets at least twice as many slots as the array can hold entries.
+    void grow(std::size_t capacity) {
+        Entry* entries = std::allocator<Entry>().allocate(capacity);
+        for (std::size_t i = 0; i < size_; i++) {
+            new (&entries[i]) Entry(std::move(data()[i]));
+            data()[i].~Entry();
+        }
+        if (heap_ != nullptr) {
+            std::allocator<Entry>().deallocate(heap_, capacity_);
+        }
+        heap_ = entries;
+        capacity_ = capacity;
+
+        std::size_t slots = 1;
+        while (slots < 2 * capacity) {
+            slots *= 2;
+        }
+        index_.reset(new Slot[slots]());
+        indexMask_ = slots - 1;
+        for (std::size_t i = 0; i < size_; i++) {
+            insertSlot(i, hashOf(entries[i].key));
+        }
+    }
+
+    void append(Entry&& entry) {
+        if (size_ == capacity_) {
+            grow(2 * capacity_);
+        }
+        new (&data()[size_]) Entry(std::move(entry));
+        if (heap_ != nullptr) {
+            insertSlot(size_, hashOf(data()[size_].key));
+        }
+        size_++;
+    }
+
+    void copyFrom(const PropertyStore& other) {
+        if (other.size_ > InlineCapacity) {
+            grow(other.capacity_);
+        }
+        for (const Entry& entry : other) {
+            append(Entry(entry));
+        }
+    }
+
+    void moveFrom(PropertyStore& other) {
+        if (other.heap_ != nullptr) {
+            heap_ = other.heap_;
+            capacity_ = other.capacity_;
+            size_ = other.size_;
+            index_ = std::move(other.index_);
+            indexMask_ = other.indexMask_;
+            other.heap_ = nullptr;
+            other.capacity_ = InlineCapacity;
+            other.size_ = 0;
+            other.indexMask_ = 0;
+            return;
+        }
+        for (std::size_t i = 0; i < other.size_; i++) {
+            new (&data()[i]) Entry(std::move(other.data()[i]));
+            other.data()[i].~Entry();
+        }
+        size_ = other.size_;
+        other.size_ = 0;
+    }
+
+    alignas(Entry) unsigned char buffer_[InlineCapacity * sizeof(Entry)];
+    Entry* heap_ = nullptr;
+    std::unique_ptr<Slot[]> index_;
+    std::size_t indexMask_ = 0;
+    std::size_t capacity_ = InlineCapacity;
+    std::size_t size_ = 0;
+};
+
+} // namespace ding
+
+#endif // PROPERTY_STORE_H
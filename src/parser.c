@@ -3,114 +3,310 @@
 #include <string.h>
 #include <ctype.h>
 
-#define MAX_TOKEN_LENGTH 100
-#define MAX_TOKENS 1000
-#define HASH_TABLE_SIZE 101
+#define HASH_TABLE_INITIAL_BITS 6  // log2 of the initial capacity
+#define HASH_TABLE_MAX_LOAD_PERCENT 70
+#define ARENA_CHUNK_SIZE 65536
 
-// Simple STRUCTURES for a Hash Table (to mimic complex structures)
+// Arena: bump allocator whose chunks are all released at once by arena_free
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk *head;
+} Arena;
+
+// Allocate from the arena (8-byte aligned)
+void *arena_alloc(Arena *arena, size_t size) {
+    size = (size + 7) & ~(size_t) 7;
+    ArenaChunk *chunk = arena->head;
+
+    if (chunk == NULL || chunk->used + size > chunk->size) {
+        size_t chunkSize = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+        if ((chunk = malloc(sizeof(*chunk) + chunkSize)) == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        chunk->next = arena->head;
+        chunk->used = 0;
+        chunk->size = chunkSize;
+        arena->head = chunk;
+    }
+
+    void *p = chunk->data + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+// Release every chunk of the arena in one pass
+void arena_free(Arena *arena) {
+    ArenaChunk *chunk = arena->head;
+    while (chunk != NULL) {
+        ArenaChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    arena->head = NULL;
+}
+
+// Stored token, allocated in the table's arena and linked in insertion order
 typedef struct Token {
-    char content[MAX_TOKEN_LENGTH];
     struct Token *next;
+    size_t length;
+    char content[];
 } Token;
 
+// Open-addressing slot: hash and length inline so probes rarely touch the token
 typedef struct {
-    Token *table[HASH_TABLE_SIZE];
+    unsigned hash;
+    unsigned length;
+    Token *token;  // NULL marks an empty slot
+} HashSlot;
+
+typedef struct {
+    HashSlot *slots;
+    size_t capacity;       // power of two
+    unsigned capacityBits; // log2(capacity)
+    size_t count;
+    Token *first;
+    Token *last;
+    Arena arena;
 } HashTable;
 
+// Load factor and probe-length statistics for a HashTable
+typedef struct {
+    size_t count;
+    size_t capacity;
+    double loadFactor;
+    double averageProbeLength;  // slots inspected by a successful lookup, on average
+    size_t maxProbeLength;
+} HashTableStats;
+
 // Function to produce hash value
-unsigned hash(const char *s) {
-    unsigned hashval;
-    for (hashval = 0; *s != '\0'; s++)
-        hashval = *s + 31 * hashval;
-    return hashval % HASH_TABLE_SIZE;
+unsigned hash(const char *s, size_t length) {
+    unsigned hashval = 0;
+    for (size_t i = 0; i < length; i++)
+        hashval = (unsigned char) s[i] + 31 * hashval;
+    return hashval;
 }
 
-// Insert token into hash table
-void insert(HashTable *hashtable, const char *content) {
-    unsigned hashval;
-    Token *newToken;
+// Home slot of a hash (Fibonacci hashing: the top capacityBits bits of the product mix in
+// every bit of the polynomial hash, whose low bits are weak)
+static size_t home_slot(const HashTable *hashtable, unsigned hashval) {
+    return (size_t) ((hashval * 2654435769u) >> (32 - hashtable->capacityBits));
+}
+
+void hashtable_init(HashTable *hashtable) {
+    memset(hashtable, 0, sizeof(*hashtable));
+    hashtable->capacityBits = HASH_TABLE_INITIAL_BITS;
+    hashtable->capacity = (size_t) 1 << HASH_TABLE_INITIAL_BITS;
+    if ((hashtable->slots = calloc(hashtable->capacity, sizeof(HashSlot))) == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+}
+
+// Free the slot array and every token in one shot
+void hashtable_free(HashTable *hashtable) {
+    free(hashtable->slots);
+    arena_free(&hashtable->arena);
+    memset(hashtable, 0, sizeof(*hashtable));
+}
 
-    if ((newToken = malloc(sizeof(*newToken))) == NULL) {
+// Find the slot holding content, or the empty slot where it would go
+static HashSlot *find_slot(const HashTable *hashtable, const char *content, size_t length, unsigned hashval) {
+    size_t mask = hashtable->capacity - 1;
+    for (size_t i = home_slot(hashtable, hashval);; i = (i + 1) & mask) {
+        HashSlot *slot = &hashtable->slots[i];
+        if (slot->token == NULL ||
+            (slot->hash == hashval && slot->length == length && memcmp(slot->token->content, content, length) == 0))
+            return slot;
+    }
+}
+
+// Double the slot array, reusing the stored hashes
+static void grow(HashTable *hashtable) {
+    HashSlot *old = hashtable->slots;
+    size_t oldCapacity = hashtable->capacity;
+
+    // Slots are picked from a 32-bit hash, so the table stops doubling at 2^32 slots
+    if (hashtable->capacityBits == 32) {
+        fprintf(stderr, "Hash table is full\n");
+        exit(1);
+    }
+    hashtable->capacityBits++;
+    hashtable->capacity *= 2;
+    if ((hashtable->slots = calloc(hashtable->capacity, sizeof(HashSlot))) == NULL) {
         fprintf(stderr, "Out of memory\n");
         exit(1);
     }
+    for (size_t i = 0; i < oldCapacity; i++) {
+        if (old[i].token == NULL)
+            continue;
+        size_t mask = hashtable->capacity - 1, j = home_slot(hashtable, old[i].hash);
+        while (hashtable->slots[j].token != NULL)
+            j = (j + 1) & mask;
+        hashtable->slots[j] = old[i];
+    }
+    free(old);
+}
+
+// Insert length bytes of content into hash table; returns 1 if it was added, 0 if already present
+int insert_n(HashTable *hashtable, const char *content, size_t length) {
+    unsigned hashval = hash(content, length);
+    HashSlot *slot = find_slot(hashtable, content, length, hashval);
+
+    if (slot->token != NULL)
+        return 0;
+
+    if ((hashtable->count + 1) * 100 > hashtable->capacity * HASH_TABLE_MAX_LOAD_PERCENT) {
+        grow(hashtable);
+        slot = find_slot(hashtable, content, length, hashval);
+    }
+
+    Token *newToken = arena_alloc(&hashtable->arena, sizeof(Token) + length + 1);
+    newToken->next = NULL;
+    newToken->length = length;
+    memcpy(newToken->content, content, length);
+    newToken->content[length] = '\0';
+
+    slot->hash = hashval;
+    slot->length = (unsigned) length;
+    slot->token = newToken;
+    hashtable->count++;
+
+    if (hashtable->last != NULL)
+        hashtable->last->next = newToken;
+    else
+        hashtable->first = newToken;
+    hashtable->last = newToken;
+    return 1;
+}
 
-    strncpy(newToken->content, content, MAX_TOKEN_LENGTH);
-    hashval = hash(content);
+// Insert token into hash table; returns 1 if it was added, 0 if already present
+int insert(HashTable *hashtable, const char *content) {
+    return insert_n(hashtable, content, strlen(content));
+}
 
-    newToken->next = hashtable->table[hashval];
-    hashtable->table[hashval] = newToken;
+// Search for length bytes of content in hash table
+int lookup_n(HashTable *hashtable, const char *content, size_t length) {
+    return find_slot(hashtable, content, length, hash(content, length))->token != NULL;
 }
 
 // Search for a token in hash table
 int lookup(HashTable *hashtable, const char *content) {
-    Token *token;
-    for (token = hashtable->table[hash(content)]; token != NULL; token = token->next) {
-        if (strcmp(content, token->content) == 0)
-            return 1;
+    return lookup_n(hashtable, content, strlen(content));
+}
+
+// Report load factor and probe lengths (distance of each entry from its home slot, plus one)
+HashTableStats hashtable_stats(const HashTable *hashtable) {
+    HashTableStats stats;
+    size_t mask = hashtable->capacity - 1, totalProbes = 0;
+
+    memset(&stats, 0, sizeof(stats));
+    stats.count = hashtable->count;
+    stats.capacity = hashtable->capacity;
+    stats.loadFactor = (double) hashtable->count / (double) hashtable->capacity;
+    for (size_t i = 0; i < hashtable->capacity; i++) {
+        if (hashtable->slots[i].token == NULL)
+            continue;
+        size_t probes = ((i - home_slot(hashtable, hashtable->slots[i].hash)) & mask) + 1;
+        totalProbes += probes;
+        if (probes > stats.maxProbeLength)
+            stats.maxProbeLength = probes;
     }
-    return 0;
+    if (hashtable->count > 0)
+        stats.averageProbeLength = (double) totalProbes / (double) hashtable->count;
+    return stats;
 }
 
-void complexProcessing(HashTable *hashtable, char *token) {
+// Per-parse state handed to the token callback; one per parseDPlusPlus call, so parses are independent
+typedef struct {
+    HashTable *hashtable;
+    char *scratch;        // modified token buffer, grown to the longest token seen
+    size_t scratchCapacity;
+} ParseState;
+
+// Callback receiving each token as tokenize finds it (token is not NUL-terminated)
+typedef void (*TokenCallback)(const char *token, size_t length, void *context);
+
+void complexProcessing(ParseState *state, const char *token, size_t length) {
     // Lengthy and convoluted processing logic
-    int i = 0, j = 0, k = 0;
-    char modifiedToken[MAX_TOKEN_LENGTH];
+    unsigned k = 0;  // wraps; only its low byte is used
+    size_t i, j = 0;
+
+    if (length > state->scratchCapacity) {
+        size_t capacity = state->scratchCapacity ? state->scratchCapacity : 64;
+        while (capacity < length)
+            capacity *= 2;
+        char *scratch = realloc(state->scratch, capacity);
+        if (scratch == NULL) {
+            fprintf(stderr, "Memory allocation error\n");
+            exit(1);
+        }
+        state->scratch = scratch;
+        state->scratchCapacity = capacity;
+    }
+    char *modifiedToken = state->scratch;
 
-    for (i = 0; token[i] != '\0'; i++) {
-        if (isalnum(token[i])) {
+    for (i = 0; i < length; i++) {
+        if (isalnum((unsigned char) token[i])) {
             modifiedToken[j++] = token[i];
             continue;
         }
         // Random operations to mimic complexity
-        k += (token[i] % 2 == 0) ? (token[i] & i) : (token[i] | i);
+        unsigned c = (unsigned char) token[i];
+        k += (c % 2 == 0) ? (c & (unsigned) i) : (c | (unsigned) i);
+        if ((char) k == '\0')
+            break;  // the modified token has always ended at its first NUL
         modifiedToken[j++] = (char) k;
     }
-    modifiedToken[j] = '\0';
 
-    if (!lookup(hashtable, modifiedToken)) {
-        insert(hashtable, modifiedToken);
-    }
+    insert_n(state->hashtable, modifiedToken, j);
 }
 
-// Split source code into tokens
-void tokenize(const char *source, char tokens[MAX_TOKENS][MAX_TOKEN_LENGTH]) {
-    char *token;
-    const char *delimiters = " \t\r\n\v\f";
-    int i = 0;
+static void processToken(const char *token, size_t length, void *context) {
+    complexProcessing(context, token, length);
+}
 
-    char *sourceCopy = strdup(source);
-    if (sourceCopy == NULL) {
-        fprintf(stderr, "Memory allocation error\n");
-        exit(1);
-    }
+// Split source code into tokens, handing each to callback as it is found.
+// Tokens point into source: nothing is copied, no state is kept, and there is no size limit.
+void tokenize(const char *source, TokenCallback callback, void *context) {
+    const char *delimiters = " \t\r\n\v\f";
+    const char *p = source;
 
-    token = strtok(sourceCopy, delimiters);
-    while (token != NULL && i < MAX_TOKENS) {
-        strncpy(tokens[i++], token, MAX_TOKEN_LENGTH);
-        token = strtok(NULL, delimiters);
+    for (;;) {
+        p += strspn(p, delimiters);
+        if (*p == '\0')
+            break;
+        size_t length = strcspn(p, delimiters);
+        callback(p, length, context);
+        p += length;
     }
-    free(sourceCopy);
 }
 
 // Simulate parsing D++ language
 void parseDPlusPlus(const char *source) {
     HashTable hashtable;
-    memset(&hashtable, 0, sizeof(hashtable));
-
-    char tokens[MAX_TOKENS][MAX_TOKEN_LENGTH];
-    tokenize(source, tokens);
+    hashtable_init(&hashtable);
 
-    for (int i = 0; tokens[i][0] != '\0'; i++) {
-        complexProcessing(&hashtable, tokens[i]);
-    }
+    ParseState state = { &hashtable, NULL, 0 };
+    tokenize(source, processToken, &state);
+    free(state.scratch);
 
     // Display stored tokens
-    for (int k = 0; k < HASH_TABLE_SIZE; k++) {
-        for (Token *t = hashtable.table[k]; t != NULL; t = t->next) {
-            printf("Token: %s\n", t->content);
-        }
+    for (Token *t = hashtable.first; t != NULL; t = t->next) {
+        printf("Token: %.*s\n", (int) t->length, t->content);
     }
+
+    HashTableStats stats = hashtable_stats(&hashtable);
+    printf("Hash table: %zu entries, capacity %zu, load factor %.2f, probe length avg %.2f max %zu\n",
+           stats.count, stats.capacity, stats.loadFactor, stats.averageProbeLength, stats.maxProbeLength);
+
+    hashtable_free(&hashtable);
 }
 
 int main() {
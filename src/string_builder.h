@@ -0,0 +1,100 @@
+#ifndef STRING_BUILDER_H
+#define STRING_BUILDER_H
+
+#include <stdlib.h>
+#include <string.h>
+
+// Growable, length-tracked string buffer. Appends copy to the tail with memcpy and the
+// capacity grows geometrically, so building a string of n bytes costs O(n) overall.
+// The contents are always NUL-terminated once the builder has allocated.
+// Functions returning int give 0 on success and -1 if memory runs out; the builder is
+// left unchanged on failure.
+
+typedef struct {
+    char *data;
+    size_t length;
+    size_t capacity;  // allocated bytes, including room for the terminating NUL
+} StringBuilder;
+
+// Function to initialize an empty builder (no allocation until the first append)
+static inline void string_builder_init(StringBuilder *sb) {
+    sb->data = NULL;
+    sb->length = 0;
+    sb->capacity = 0;
+}
+
+// Function to make room for at least `additional` more bytes without reallocating
+static inline int string_builder_reserve(StringBuilder *sb, size_t additional) {
+    if (additional > (size_t) -1 - sb->length - 1) {
+        return -1;
+    }
+    size_t needed = sb->length + additional + 1;
+    if (needed <= sb->capacity) {
+        return 0;
+    }
+    size_t capacity = sb->capacity < 64 ? 64 : sb->capacity;
+    while (capacity < needed) {
+        capacity = capacity > (size_t) -1 / 2 ? needed : capacity * 2;
+    }
+    char *data = realloc(sb->data, capacity);
+    if (data == NULL) {
+        return -1;
+    }
+    sb->data = data;
+    sb->capacity = capacity;
+    return 0;
+}
+
+// Function to append `length` bytes
+static inline int string_builder_append_n(StringBuilder *sb, const char *text, size_t length) {
+    if (string_builder_reserve(sb, length) != 0) {
+        return -1;
+    }
+    memcpy(sb->data + sb->length, text, length);
+    sb->length += length;
+    sb->data[sb->length] = '\0';
+    return 0;
+}
+
+// Function to append a NUL-terminated string
+static inline int string_builder_append(StringBuilder *sb, const char *text) {
+    return string_builder_append_n(sb, text, strlen(text));
+}
+
+// Function to append `count` strings with one reservation for all of them
+static inline int string_builder_append_all(StringBuilder *sb, const char *const *segments, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) {
+        total += strlen(segments[i]);
+    }
+    if (string_builder_reserve(sb, total) != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t length = strlen(segments[i]);
+        memcpy(sb->data + sb->length, segments[i], length);
+        sb->length += length;
+    }
+    sb->data[sb->length] = '\0';
+    return 0;
+}
+
+// Function to take ownership of the contents (free() them); the builder is left empty.
+// Returns NULL only if nothing could be allocated.
+static inline char *string_builder_finish(StringBuilder *sb) {
+    if (sb->data == NULL && string_builder_reserve(sb, 0) != 0) {
+        return NULL;
+    }
+    char *data = sb->data;
+    data[sb->length] = '\0';
+    string_builder_init(sb);
+    return data;
+}
+
+// Function to release the contents
+static inline void string_builder_free(StringBuilder *sb) {
+    free(sb->data);
+    string_builder_init(sb);
+}
+
+#endif
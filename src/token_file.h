@@ -0,0 +1,317 @@
+#ifndef TOKEN_FILE_H
+#define TOKEN_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "string_builder.h"
+
+// Binary token stream and AST format shared by the C front end and ParsesIndex.rs (see
+// TokenFile there). A file is a TokenFileHeader followed by sections of flat arrays:
+// no pointers, no variable-length records, every section 8-byte aligned. A reader
+// validates the header and counts once and then uses the arrays in place, so a file can
+// be memory-mapped and consumed without parsing. All integers are little-endian.
+//
+// The source text is embedded, and token text is source[offset, offset + length).
+// Token columns and lines are 1-based; columns count bytes from the start of the line.
+// The AST section is optional (node_count 0, root TOKEN_FILE_NONE). Nodes refer to
+// other nodes by index, to child lists by (start, length) in the list section and to
+// names by index in the string table.
+//
+// Keep this header and the TokenFile code in ParsesIndex.rs in step; bump
+// TOKEN_FILE_VERSION for any layout change.
+
+#define TOKEN_FILE_MAGIC "DPTF"
+#define TOKEN_FILE_VERSION 1u
+#define TOKEN_FILE_NONE 0xFFFFFFFFu
+
+// Token types (the Rust TokenType discriminants)
+enum {
+    TOKEN_FILE_IDENTIFIER,
+    TOKEN_FILE_KEYWORD,
+    TOKEN_FILE_OPERATOR,
+    TOKEN_FILE_LITERAL,
+    TOKEN_FILE_SEPARATOR,
+    TOKEN_FILE_COMMENT,
+    TOKEN_FILE_WHITESPACE,
+    TOKEN_FILE_EOF,
+    TOKEN_FILE_TYPE_COUNT
+};
+
+// Node kinds and the meaning of their fields
+enum {
+    TOKEN_FILE_PROGRAM,          // list start, list length
+    TOKEN_FILE_FUNCTION,         // name, parameter list start, length, return type node, body node
+    TOKEN_FILE_VARIABLE,         // name, type node, initializer node or TOKEN_FILE_NONE
+    TOKEN_FILE_TYPE,             // name
+    TOKEN_FILE_BLOCK,            // list start, list length
+    TOKEN_FILE_EXPRESSION,       // expression node
+    TOKEN_FILE_BINARY,           // left node, operator (= == != < <= > >= + - * /, from 0), right node
+    TOKEN_FILE_UNARY,            // operator (! -, from 0), operand node
+    TOKEN_FILE_LITERAL_NODE,     // text
+    TOKEN_FILE_IDENTIFIER_NODE,  // name
+    TOKEN_FILE_NODE_KIND_COUNT
+};
+
+#define TOKEN_FILE_BINARY_OPS 11u
+#define TOKEN_FILE_UNARY_OPS 2u
+
+// Sections, in file order
+enum {
+    TOKEN_FILE_SOURCE,        // char[source_length]
+    TOKEN_FILE_TYPES,         // uint8_t[token_count]
+    TOKEN_FILE_OFFSETS,       // uint32_t[token_count]
+    TOKEN_FILE_LENGTHS,       // uint32_t[token_count]
+    TOKEN_FILE_LINES,         // uint32_t[token_count]
+    TOKEN_FILE_COLUMNS,       // uint32_t[token_count]
+    TOKEN_FILE_NODES,         // TokenFileNode[node_count]
+    TOKEN_FILE_LISTS,         // uint32_t[list_count] node indices
+    TOKEN_FILE_STRINGS,       // uint32_t[2 * string_count] (offset, length) into string bytes
+    TOKEN_FILE_STRING_BYTES,  // char[]
+    TOKEN_FILE_SECTION_COUNT
+};
+
+typedef struct {
+    uint32_t kind;
+    uint32_t fields[5];  // unused fields are 0
+} TokenFileNode;
+
+typedef struct {
+    uint64_t offset;  // from the start of the file, a multiple of 8
+    uint64_t bytes;
+} TokenFileSection;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t header_bytes;  // sizeof(TokenFileHeader)
+    uint32_t flags;         // 0
+    uint64_t source_length;
+    uint32_t token_count;
+    uint32_t node_count;
+    uint32_t list_count;
+    uint32_t string_count;
+    uint32_t root;          // root node, or TOKEN_FILE_NONE without an AST
+    uint32_t reserved;      // 0
+    TokenFileSection sections[TOKEN_FILE_SECTION_COUNT];
+} TokenFileHeader;
+
+_Static_assert(sizeof(TokenFileHeader) == 208, "TokenFileHeader layout is part of the format");
+_Static_assert(sizeof(TokenFileNode) == 24, "TokenFileNode layout is part of the format");
+
+// A validated file; every pointer points into the caller's buffer
+typedef struct {
+    const TokenFileHeader *header;
+    const char *source;
+    const uint8_t *types;
+    const uint32_t *offsets;
+    const uint32_t *lengths;
+    const uint32_t *lines;
+    const uint32_t *columns;
+    const TokenFileNode *nodes;
+    const uint32_t *lists;
+    const uint32_t *strings;
+    const char *string_bytes;
+} TokenFile;
+
+// Function to check that this host can use the arrays in place (little-endian)
+static inline int token_file_host_supported(void) {
+    const uint32_t probe = 1;
+    unsigned char first;
+    memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+static inline size_t token_file_align(size_t n) {
+    return (n + 7) & ~(size_t) 7;
+}
+
+// Function to check that `child` is a node before `parent` (or, with `optional`,
+// TOKEN_FILE_NONE). Children always precede their parents, which rules out cycles.
+static inline int token_file_child_ok(uint32_t parent, uint32_t child, int optional) {
+    return child < parent || (optional && child == TOKEN_FILE_NONE);
+}
+
+// Function to check that a (start, length) child list lies inside the list section and
+// holds only nodes before `parent`
+static inline int token_file_list_ok(const TokenFile *file, uint32_t parent, uint32_t start, uint32_t length) {
+    if (start > file->header->list_count || length > file->header->list_count - start) {
+        return 0;
+    }
+    for (uint32_t i = start; i < start + length; i++) {
+        if (file->lists[i] >= parent) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Function to validate `size` bytes at `data` (8-byte aligned, e.g. from mmap) and point
+// `file` at its arrays. Returns 0, or -1 for a foreign, truncated or inconsistent file,
+// or a big-endian host. After this every index in the file is known to be in range
+// (token lines and columns are not checked).
+static inline int token_file_open(TokenFile *file, const void *data, size_t size) {
+    const char *bytes = data;
+    const TokenFileHeader *header = data;
+    if (!token_file_host_supported() || ((uintptr_t) data & 7) != 0 || size < sizeof *header ||
+        memcmp(header->magic, TOKEN_FILE_MAGIC, 4) != 0 || header->version != TOKEN_FILE_VERSION ||
+        header->header_bytes != sizeof *header || header->flags != 0 || header->source_length > UINT32_MAX) {
+        return -1;
+    }
+
+    const uint64_t tokens = header->token_count;
+    const uint64_t expected[TOKEN_FILE_SECTION_COUNT] = {
+        header->source_length, tokens, 4 * tokens, 4 * tokens, 4 * tokens, 4 * tokens,
+        (uint64_t) header->node_count * sizeof(TokenFileNode), 4 * (uint64_t) header->list_count,
+        8 * (uint64_t) header->string_count, header->sections[TOKEN_FILE_STRING_BYTES].bytes,
+    };
+    for (int i = 0; i < TOKEN_FILE_SECTION_COUNT; i++) {
+        const TokenFileSection *section = &header->sections[i];
+        if (section->bytes != expected[i] || (section->offset & 7) != 0 || section->offset > size ||
+            section->bytes > size - section->offset) {
+            return -1;
+        }
+    }
+
+    file->header = header;
+    file->source = bytes + header->sections[TOKEN_FILE_SOURCE].offset;
+    file->types = (const uint8_t *) (bytes + header->sections[TOKEN_FILE_TYPES].offset);
+    file->offsets = (const uint32_t *) (bytes + header->sections[TOKEN_FILE_OFFSETS].offset);
+    file->lengths = (const uint32_t *) (bytes + header->sections[TOKEN_FILE_LENGTHS].offset);
+    file->lines = (const uint32_t *) (bytes + header->sections[TOKEN_FILE_LINES].offset);
+    file->columns = (const uint32_t *) (bytes + header->sections[TOKEN_FILE_COLUMNS].offset);
+    file->nodes = (const TokenFileNode *) (bytes + header->sections[TOKEN_FILE_NODES].offset);
+    file->lists = (const uint32_t *) (bytes + header->sections[TOKEN_FILE_LISTS].offset);
+    file->strings = (const uint32_t *) (bytes + header->sections[TOKEN_FILE_STRINGS].offset);
+    file->string_bytes = bytes + header->sections[TOKEN_FILE_STRING_BYTES].offset;
+
+    for (uint32_t i = 0; i < header->token_count; i++) {
+        if (file->types[i] >= TOKEN_FILE_TYPE_COUNT || file->offsets[i] > header->source_length ||
+            file->lengths[i] > header->source_length - file->offsets[i]) {
+            return -1;
+        }
+    }
+    uint64_t string_bytes = header->sections[TOKEN_FILE_STRING_BYTES].bytes;
+    for (uint32_t i = 0; i < header->string_count; i++) {
+        if (file->strings[2 * i] > string_bytes || file->strings[2 * i + 1] > string_bytes - file->strings[2 * i]) {
+            return -1;
+        }
+    }
+    for (uint32_t i = 0; i < header->node_count; i++) {
+        const uint32_t *f = file->nodes[i].fields;
+        int ok;
+        switch (file->nodes[i].kind) {
+        case TOKEN_FILE_PROGRAM:
+        case TOKEN_FILE_BLOCK:
+            ok = token_file_list_ok(file, i, f[0], f[1]);
+            break;
+        case TOKEN_FILE_FUNCTION:
+            ok = f[0] < header->string_count && token_file_list_ok(file, i, f[1], f[2]) &&
+                 token_file_child_ok(i, f[3], 0) && token_file_child_ok(i, f[4], 0);
+            break;
+        case TOKEN_FILE_VARIABLE:
+            ok = f[0] < header->string_count && token_file_child_ok(i, f[1], 0) && token_file_child_ok(i, f[2], 1);
+            break;
+        case TOKEN_FILE_EXPRESSION:
+            ok = token_file_child_ok(i, f[0], 0);
+            break;
+        case TOKEN_FILE_BINARY:
+            ok = token_file_child_ok(i, f[0], 0) && f[1] < TOKEN_FILE_BINARY_OPS && token_file_child_ok(i, f[2], 0);
+            break;
+        case TOKEN_FILE_UNARY:
+            ok = f[0] < TOKEN_FILE_UNARY_OPS && token_file_child_ok(i, f[1], 0);
+            break;
+        case TOKEN_FILE_TYPE:
+        case TOKEN_FILE_LITERAL_NODE:
+        case TOKEN_FILE_IDENTIFIER_NODE:
+            ok = f[0] < header->string_count;
+            break;
+        default:
+            ok = 0;
+            break;
+        }
+        if (!ok) {
+            return -1;
+        }
+    }
+    return token_file_child_ok(header->node_count, header->root, 1) ? 0 : -1;
+}
+
+// Function to get a token's text (not NUL-terminated, see file->lengths)
+static inline const char *token_file_text(const TokenFile *file, uint32_t token) {
+    return file->source + file->offsets[token];
+}
+
+// Function to get string table entry `index` (not NUL-terminated)
+static inline const char *token_file_string(const TokenFile *file, uint32_t index, uint32_t *length) {
+    *length = file->strings[2 * index + 1];
+    return file->string_bytes + file->strings[2 * index];
+}
+
+// Function to append `bytes` of `data` and zero-pad to the next multiple of 8
+static inline int token_file_put_section(StringBuilder *out, TokenFileHeader *header, int section,
+                                         const void *data, size_t bytes) {
+    size_t start = out->length;
+    size_t padded = token_file_align(bytes);
+    if (string_builder_reserve(out, padded) != 0) {
+        return -1;
+    }
+    if (bytes != 0) {
+        memcpy(out->data + start, data, bytes);
+    }
+    memset(out->data + start + bytes, 0, padded - bytes);
+    out->length += padded;
+    out->data[out->length] = '\0';
+    header->sections[section].offset = start;
+    header->sections[section].bytes = bytes;
+    return 0;
+}
+
+// Function to append a token-only file (no AST) for `count` tokens of `source` to `out`,
+// which must be empty or hold a multiple of 8 bytes. Types are TOKEN_FILE_* values.
+// Returns 0, or -1 if memory runs out, the host is big-endian or the source passes 4 GiB.
+static inline int token_file_write_tokens(StringBuilder *out, const char *source, size_t source_length,
+                                          const uint8_t *types, const uint32_t *offsets, const uint32_t *lengths,
+                                          const uint32_t *lines, const uint32_t *columns, uint32_t count) {
+    TokenFileHeader header;
+    size_t base = out->length;
+    if (!token_file_host_supported() || (base & 7) != 0 || source_length > UINT32_MAX ||
+        string_builder_reserve(out, sizeof header) != 0) {
+        return -1;
+    }
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, TOKEN_FILE_MAGIC, 4);
+    header.version = TOKEN_FILE_VERSION;
+    header.header_bytes = sizeof header;
+    header.source_length = source_length;
+    header.token_count = count;
+    header.root = TOKEN_FILE_NONE;
+    out->length += sizeof header;
+
+    const size_t column_bytes = (size_t) count * sizeof(uint32_t);
+    if (token_file_put_section(out, &header, TOKEN_FILE_SOURCE, source, source_length) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_TYPES, types, count) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_OFFSETS, offsets, column_bytes) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_LENGTHS, lengths, column_bytes) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_LINES, lines, column_bytes) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_COLUMNS, columns, column_bytes) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_NODES, NULL, 0) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_LISTS, NULL, 0) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_STRINGS, NULL, 0) != 0 ||
+        token_file_put_section(out, &header, TOKEN_FILE_STRING_BYTES, NULL, 0) != 0) {
+        out->length = base;
+        if (out->data != NULL) {
+            out->data[base] = '\0';
+        }
+        return -1;
+    }
+    // Section offsets are relative to the start of this file
+    for (int i = 0; i < TOKEN_FILE_SECTION_COUNT; i++) {
+        header.sections[i].offset -= base;
+    }
+    memcpy(out->data + base, &header, sizeof header);
+    return 0;
+}
+
+#endif
@@ -0,0 +1,32 @@
+#!/bin/bash
+# Build the lexers and the driver with optimizations, generate synthetic corpora and
+# benchmark every stage. Results are JSON lines (one per stage and corpus) in $OUT.
+# Usage: vode.c/bench.sh [OUT] [ITERATIONS]
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=${1:-bench.jsonl}
+ITERATIONS=${2:-5}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+gcc -O2 -o "$WORK/lexer" "$ROOT/src/Lexer.c"
+rustc --edition 2021 -O -o "$WORK/dpp" "$ROOT/src/ParsesIndex.rs"
+
+: > "$OUT"
+# name size identifiers depth
+while read -r NAME SIZE IDENTS DEPTH; do
+    CORPUS="$WORK/$NAME.dpp"
+    "$WORK/dpp" --gen-corpus "$CORPUS" --corpus-size "$SIZE" --corpus-idents "$IDENTS" --corpus-depth "$DEPTH"
+    {
+        "$WORK/lexer" --bench "$CORPUS" "$ITERATIONS"
+        "$WORK/dpp" --bench "$CORPUS" --iterations "$ITERATIONS" -O1
+    } | sed "s/^{/{\"corpus\":\"$NAME\",/" >> "$OUT"
+done <<CORPORA
+small 64K 100 4
+wide 16M 100000 4
+deep 16M 1000 64
+large 64M 10000 8
+CORPORA
+
+echo "Wrote $(wc -l < "$OUT") results to $OUT"
@@ -0,0 +1,141 @@
+#!/bin/bash
+# Differential check of the x86-64 backends: generated programs are compiled at every
+# optimization level, assembled with gas, linked into a small driver and run. The driver
+# calls the top-level code and then each function in order, printing every variable
+# after each call; every level must print what the first level prints. A division by
+# zero traps, and optimizing may delete a trapping expression whose value is unused, so
+# when the first level traps only the lines before the trap are compared. A later level
+# must never trap where the first one did not.
+# Usage: vode.c/codegen_check.sh [PROGRAMS] [LEVELS]
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+PROGRAMS=${1:-100}
+LEVELS=${2:-"0 1 2"}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+rustc --edition 2021 -O -o "$WORK/dpp" "$ROOT/src/ParsesIndex.rs"
+
+# Turn the driver's assembly into gas input: unique symbol names, variables as .data
+# quads with fixed nonzero initial values (repeating, so comparisons also see equal
+# operands), top-level code wrapped in dpp_init, and a
+# C driver that runs it all. The generated code keeps no ABI, so calls go through
+# dpp_call, which saves the callee-saved registers.
+wrap() {
+    # First pass collects the function and variable names, the second emits
+    awk -v driver="$2" '
+        # [name] becomes a RIP-relative reference to dpp_name, with an explicit size
+        function rename(line,    out) {
+            gsub(/qword \[/, "qword ptr [", line)
+            gsub(/byte \[/, "byte ptr [", line)
+            out = ""
+            while (match(line, /\[[A-Za-z_][A-Za-z0-9_]*\]/)) {
+                out = out substr(line, 1, RSTART - 1) "[rip + dpp_" substr(line, RSTART + 1, RLENGTH - 1)
+                line = substr(line, RSTART + RLENGTH)
+            }
+            return out line
+        }
+        NR == FNR {
+            if ($0 ~ /^[A-Za-z_][A-Za-z0-9_]*:$/) {
+                functions[++nfunctions] = substr($0, 1, length($0) - 1)
+            }
+            line = $0
+            while (match(line, /\[[A-Za-z_][A-Za-z0-9_]*\]/)) {
+                variable = substr(line, RSTART + 1, RLENGTH - 2)
+                if (!(variable in seen)) {
+                    seen[variable] = 1
+                    variables[++nvariables] = variable
+                }
+                line = substr(line, RSTART + RLENGTH)
+            }
+            next
+        }
+        FNR == 1 {
+            print ".intel_syntax noprefix\n.section .note.GNU-stack,\"\",@progbits\n.data"
+            for (i = 1; i <= nvariables; i++) {
+                printf ".globl dpp_%s\ndpp_%s: .quad %d\n", variables[i], variables[i], 5 * (i % 4) - 4
+            }
+            print ".text\n.globl dpp_call\ndpp_call:"
+            print "    push rbx\n    push rbp\n    push r12\n    push r13\n    push r14\n    push r15\n    sub rsp, 8"
+            print "    call rdi"
+            print "    add rsp, 8\n    pop r15\n    pop r14\n    pop r13\n    pop r12\n    pop rbp\n    pop rbx\n    ret"
+            print ".globl dpp_init\ndpp_init:"
+            init = 1
+        }
+        {
+            line = rename($0)
+            if (line ~ /^[A-Za-z_][A-Za-z0-9_]*:$/) {
+                if (init) {
+                    print "    ret"
+                    init = 0
+                }
+                print ".globl dpp_" substr(line, 1, length(line) - 1)
+                print "dpp_" line
+            } else if (line != "") {
+                print line
+            }
+        }
+        END {
+            if (init) {
+                print "    ret"
+            }
+            printf "#include <signal.h>\n#include <stdio.h>\n#include <unistd.h>\n\n" > driver
+            printf "void dpp_call(void (*)(void));\nvoid dpp_init(void);\n" > driver
+            for (i = 1; i <= nfunctions; i++) {
+                printf "void dpp_%s(void);\n", functions[i] > driver
+            }
+            for (i = 1; i <= nvariables; i++) {
+                printf "extern long dpp_%s;\n", variables[i] > driver
+            }
+            printf "\nstatic void dump(const char *after) {\n    printf(\"after %%s:\", after);\n" > driver
+            for (i = 1; i <= nvariables; i++) {
+                printf "    printf(\" %s=%%ld\", dpp_%s);\n", variables[i], variables[i] > driver
+            }
+            printf "    printf(\"\\n\");\n    fflush(stdout);\n}\n\n" > driver
+            printf "static void on_trap(int signal) {\n    (void) signal;\n    write(1, \"trap\\n\", 5);\n    _exit(1);\n}\n\n" > driver
+            printf "int main(void) {\n    signal(SIGFPE, on_trap);\n" > driver
+            printf "    dpp_call(dpp_init);\n    dump(\"init\");\n" > driver
+            for (i = 1; i <= nfunctions; i++) {
+                printf "    dpp_call(dpp_%s);\n    dump(\"%s\");\n", functions[i], functions[i] > driver
+            }
+            printf "    return 0;\n}\n" > driver
+        }
+    ' "$1" "$1"
+}
+
+failed=0
+compared=0
+for SEED in $(seq 1 "$PROGRAMS"); do
+    SOURCE="$WORK/program-$SEED.dpp"
+    "$WORK/dpp" --gen-corpus "$SOURCE" --corpus-size 2K --corpus-idents $((4 + SEED % 12)) \
+        --corpus-depth $((1 + SEED % 10)) --corpus-seed "$SEED"
+    for LEVEL in $LEVELS; do
+        BASE="$WORK/program-$SEED-O$LEVEL"
+        "$WORK/dpp" "$SOURCE" --emit-asm "-O$LEVEL" | sed -n '/^Assembly:$/,$p' | sed '1d;/^D++ C Parser initialization complete\.$/d' > "$BASE.asm"
+        wrap "$BASE.asm" "$BASE.c" > "$BASE.s"
+        gcc -o "$BASE" "$BASE.s" "$BASE.c"
+        status=0
+        "$BASE" > "$BASE.out" || status=$?
+        echo "exit $status" >> "$BASE.out"
+    done
+    set -- $LEVELS
+    FIRST="$WORK/program-$SEED-O$1.out"
+    # Without a trap at the first level the outputs must be identical, exit line included;
+    # after one, the lines before "trap"
+    LINES=$(wc -l < "$FIRST")
+    if [ "$(tail -n 1 "$FIRST")" != "exit 0" ]; then
+        LINES=$((LINES - 2))
+    fi
+    compared=$((compared + LINES))
+    for LEVEL in "${@:2}"; do
+        if ! diff <(head -n "$LINES" "$FIRST") <(head -n "$LINES" "$WORK/program-$SEED-O$LEVEL.out") > "$WORK/diff"; then
+            echo "MISMATCH seed $SEED: -O$1 and -O$LEVEL differ"
+            head -n 5 "$WORK/diff"
+            failed=1
+        fi
+    done
+done
+
+[ "$failed" -eq 0 ] && echo "All $PROGRAMS programs agree at -O${LEVELS// / and -O} ($compared results compared)"
+exit "$failed"
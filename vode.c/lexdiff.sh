@@ -0,0 +1,84 @@
+#!/bin/bash
+# Differential and throughput harness for the two lexers. For every input shape, corpora
+# from SEEDS seeds are lexed by Lexer.c into token files and ParsesIndex --check-tokens
+# lexes each source again, serially and in parallel, requiring identical streams (types,
+# text, lines, columns, offsets); Lexer.c's lexer_relex is fuzzed against fresh lexes. The first seed's corpus is then benchmarked with both
+# lexers; their JSON lines (tokens_per_s, mb_per_s) go to $OUT tagged with the shape.
+# Given BASELINE (an earlier $OUT), fails if any lexer's mb_per_s or tokens_per_s on a
+# shape fell more than $TOLERANCE percent (default 10) below the baseline.
+# Usage: vode.c/lexdiff.sh [OUT] [BASELINE] [ITERATIONS] [SEEDS]
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+OUT=${1:-lexdiff.jsonl}
+BASELINE=$2
+ITERATIONS=${3:-5}
+SEEDS=${4:-8}
+TOLERANCE=${TOLERANCE:-10}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+gcc -O2 -o "$WORK/lexer" "$ROOT/src/Lexer.c"
+rustc --edition 2021 -O -o "$WORK/dpp" "$ROOT/src/ParsesIndex.rs"
+# Incremental re-lexing must agree with a fresh lex (includes the "1.x" -> "1.5" lookahead case)
+"$WORK/lexer" --relex-fuzz 50000
+
+: > "$OUT"
+# shape size idents
+while read -r SHAPE SIZE IDENTS; do
+    for SEED in $(seq 1 "$SEEDS"); do
+        CORPUS="$WORK/$SHAPE-$SEED.dpp"
+        # Later seeds are smaller: many varied inputs for the check, one large one to time
+        [ "$SEED" -eq 1 ] && BYTES=$SIZE || BYTES=256K
+        "$WORK/dpp" --gen-corpus "$CORPUS" --corpus-shape "$SHAPE" --corpus-size "$BYTES" \
+            --corpus-idents "$IDENTS" --corpus-seed "$SEED"
+        "$WORK/lexer" --emit-tokens "$CORPUS" "$CORPUS.dptf"
+        "$WORK/dpp" --check-tokens "$CORPUS.dptf" > /dev/null
+        "$WORK/dpp" --check-tokens "$CORPUS.dptf" --lex-jobs 4 > /dev/null
+    done
+    CORPUS="$WORK/$SHAPE-1.dpp"
+    {
+        "$WORK/lexer" --bench "$CORPUS" "$ITERATIONS"
+        "$WORK/dpp" --bench "$CORPUS" --iterations "$ITERATIONS" | grep '"stage":"rust-lexer"'
+    } | sed "s/^{/{\"corpus\":\"$SHAPE\",/" >> "$OUT"
+    rm -f "$WORK/$SHAPE"-*
+done <<SHAPES
+program 16M 1000
+identifiers 16M 100000
+numbers 16M 1000
+whitespace 16M 1000
+long-lines 16M 1000
+SHAPES
+
+# Only ' ', '\t', '\n' and '\r' are whitespace: both lexers must reject '\v' and '\f'
+for SPACE in '\v' '\f'; do
+    printf "let a: int = 1;$SPACE\n" > "$WORK/space.dpp"
+    if "$WORK/lexer" --emit-tokens "$WORK/space.dpp" "$WORK/space.dptf" 2> /dev/null \
+        || ! "$WORK/dpp" "$WORK/space.dpp" 2>&1 > /dev/null | grep -q '^Lexer error'; then
+        echo "MISMATCH: the lexers disagree on whether $SPACE is whitespace"
+        exit 1
+    fi
+done
+
+echo "Token streams match on $((5 * SEEDS)) inputs; wrote $(wc -l < "$OUT") results to $OUT"
+
+if [ -n "$BASELINE" ]; then
+    # corpus stage mb_per_s tokens_per_s, one record per line
+    fields() {
+        sed -E 's/.*"corpus":"([^"]*)".*"stage":"([^"]*)".*"mb_per_s":([0-9.]+),"tokens_per_s":([0-9.]+).*/\1 \2 \3 \4/' "$1"
+    }
+    fields "$BASELINE" > "$WORK/baseline"
+    fields "$OUT" | awk -v tolerance="$TOLERANCE" '
+        NR == FNR { mb[$1 " " $2] = $3; tokens[$1 " " $2] = $4; next }
+        ($1 " " $2) in mb {
+            floor = 1 - tolerance / 100
+            if ($3 < mb[$1 " " $2] * floor || $4 < tokens[$1 " " $2] * floor) {
+                printf "REGRESSION %s %s: %.2f MB/s, %.0f tokens/s (baseline %.2f MB/s, %.0f tokens/s)\n",
+                    $1, $2, $3, $4, mb[$1 " " $2], tokens[$1 " " $2]
+                failed = 1
+            }
+        }
+        END { exit failed }
+    ' "$WORK/baseline" -
+    echo "No lexer is more than $TOLERANCE% below $BASELINE"
+fi